@@ -0,0 +1,255 @@
+/*
+ * File: Arena.c
+ *
+ * Memory is handed out from the front chunk of a list of chunks. When it
+ * runs out a new chunk goes on the front, except that big requests get a
+ * chunk of their own behind the front one, so they don't waste what is
+ * left of it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "Arena.h"
+
+#define ALIGN 16
+#define ROUND(n) (((n) + ALIGN - 1) & ~(size_t)(ALIGN - 1))
+#define DEFAULT_CHUNK_SIZE (64 * 1024)
+
+struct Chunk {
+	struct Chunk* next;
+	size_t size;	// Bytes of memory after the header
+	size_t used;
+};
+
+#define HEADER ROUND(sizeof(struct Chunk))
+
+struct Arena {
+	size_t chunk_size;
+	struct Chunk* chunks;	// Front chunk first
+	void* last;		// Most recent allocation from the front chunk
+};
+
+/**
+ * Allocate, initialize and return a new (empty) Arena that gets memory
+ * from the system in chunks of (at least) the given size, or a default
+ * size if it is 0.
+ */
+Arena new_Arena(size_t chunk_size) {
+	Arena this = (Arena)malloc(sizeof(struct Arena));
+	this->chunk_size = chunk_size > 0 ? ROUND(chunk_size) : DEFAULT_CHUNK_SIZE;
+	this->chunks = NULL;
+	this->last = NULL;
+	return this;
+}
+
+/**
+ * Free the given Arena and all the memory allocated from it.
+ */
+void Arena_free(Arena this) {
+	if (this == NULL) {
+		return;
+	}
+	struct Chunk* chunk = this->chunks;
+	while (chunk != NULL) {
+		struct Chunk* next = chunk->next;
+		free(chunk);
+		chunk = next;
+	}
+	free(this);
+}
+
+/**
+ * Give back all the memory allocated from the given Arena at once, but
+ * keep a chunk of it to be reused by later allocations.
+ */
+void Arena_reset(Arena this) {
+	struct Chunk* keep = NULL;
+	struct Chunk* chunk = this->chunks;
+	while (chunk != NULL) {
+		struct Chunk* next = chunk->next;
+		if (keep == NULL && chunk->size == this->chunk_size) {
+			keep = chunk;
+		} else {
+			free(chunk);
+		}
+		chunk = next;
+	}
+	if (keep != NULL) {
+		keep->next = NULL;
+		keep->used = 0;
+	}
+	this->chunks = keep;
+	this->last = NULL;
+}
+
+/**
+ * Return a new chunk with room for size bytes.
+ */
+static struct Chunk* new_Chunk(size_t size) {
+	struct Chunk* chunk = (struct Chunk*)malloc(HEADER + size);
+	chunk->size = size;
+	chunk->used = 0;
+	return chunk;
+}
+
+/**
+ * Return size bytes from the given Arena (or from malloc() if it is NULL),
+ * suitably aligned for any type.
+ */
+void *Arena_malloc(Arena this, size_t size) {
+	if (this == NULL) {
+		return malloc(size);
+	}
+	size = ROUND(size > 0 ? size : 1);
+	struct Chunk* front = this->chunks;
+	if (front == NULL || front->used + size > front->size) {
+		if (size > this->chunk_size / 4 && front != NULL) {
+			// Big: a chunk of its own, behind the front chunk
+			struct Chunk* chunk = new_Chunk(size);
+			chunk->used = size;
+			chunk->next = front->next;
+			front->next = chunk;
+			return (char*)chunk + HEADER;
+		}
+		front = new_Chunk(size > this->chunk_size ? size : this->chunk_size);
+		front->next = this->chunks;
+		this->chunks = front;
+	}
+	void *p = (char*)front + HEADER + front->used;
+	front->used += size;
+	this->last = p;
+	return p;
+}
+
+/**
+ * Like Arena_malloc(), but for count elements of the given size, set to 0.
+ */
+void *Arena_calloc(Arena this, size_t count, size_t size) {
+	if (this == NULL) {
+		return calloc(count, size);
+	}
+	void *p = Arena_malloc(this, count * size);
+	memset(p, 0, count * size);
+	return p;
+}
+
+/**
+ * Return memory of new_size bytes holding the first bytes of the given
+ * memory of old_size bytes from the same Arena (or realloc() it if the
+ * Arena is NULL). The most recent allocation is grown in place if there
+ * is room.
+ */
+void *Arena_realloc(Arena this, void *p, size_t old_size, size_t new_size) {
+	if (this == NULL) {
+		return realloc(p, new_size);
+	}
+	if (p == NULL) {
+		return Arena_malloc(this, new_size);
+	}
+	if (new_size <= old_size) {
+		return p;
+	}
+	struct Chunk* front = this->chunks;
+	if (p == this->last) {
+		size_t start = (char*)p - ((char*)front + HEADER);
+		if (start + ROUND(new_size) <= front->size) {
+			front->used = start + ROUND(new_size);
+			return p;
+		}
+	}
+	void *q = Arena_malloc(this, new_size);
+	memcpy(q, p, old_size);
+	return q;
+}
+
+/**
+ * Release the given memory from the given Arena. This does nothing (the
+ * memory comes back with the rest of the Arena) unless the Arena is NULL,
+ * in which case the memory is free()'d.
+ */
+void Arena_release(Arena this, void *p) {
+	if (this == NULL) {
+		free(p);
+	}
+}
+
+#ifdef MAIN
+
+#include "check.h"
+
+/**
+ * The most recent allocation grows in place while its chunk has room,
+ * keeping what it held; any other allocation, or one that no longer
+ * fits, moves to new memory with its bytes copied.
+ */
+static void check_realloc(void) {
+	Arena arena = new_Arena(4096);
+	char *p = Arena_malloc(arena, 100);
+	memset(p, 'x', 100);
+	char *q = Arena_realloc(arena, p, 100, 200);
+	check(q == p && arena->chunks->used == 208 && q[99] == 'x', "Arena_realloc grows the last allocation in place");
+	char *r = Arena_malloc(arena, 64);
+	memset(r, 'y', 64);
+	char *s = Arena_realloc(arena, q, 200, 300);
+	check(s != q && s == r + 64 && memcmp(s, q, 200) == 0, "Arena_realloc moves an allocation that isn't the last");
+	char *t = Arena_realloc(arena, s, 300, 4000);
+	check(t != s && memcmp(t, s, 300) == 0 && r[63] == 'y', "Arena_realloc moves the last allocation when its chunk is full");
+	check(Arena_realloc(arena, t, 4000, 10) == t, "Arena_realloc keeps memory that shrinks");
+	Arena_free(arena);
+}
+
+/**
+ * A request of more than a quarter of the chunk size gets a chunk of its
+ * own behind the front one, so small allocations carry on where they left
+ * off in the front chunk.
+ */
+static void check_big(void) {
+	Arena arena = new_Arena(4096);
+	char *small = Arena_malloc(arena, 32);
+	struct Chunk *front = arena->chunks;
+	char *fits = Arena_malloc(arena, 3000);
+	check(fits == small + 32 && front->next == NULL, "a big allocation that fits goes in the front chunk");
+	char *big = Arena_malloc(arena, 2000);
+	check(arena->chunks == front && front->next != NULL && front->next->size == 2000
+		&& big == (char*)front->next + HEADER, "a big allocation that doesn't fit gets a chunk behind the front one");
+	check(Arena_malloc(arena, 32) == fits + 3008, "small allocations carry on in the front chunk");
+	char *huge = Arena_malloc(arena, 10000);
+	huge[9999] = 'z';
+	check(arena->chunks == front && front->next->size == 10000, "an allocation bigger than a chunk gets its own");
+	Arena_free(arena);
+	arena = new_Arena(4096);
+	Arena_malloc(arena, 10000);
+	check(arena->chunks->size == 10000, "a big first allocation becomes the front chunk");
+	Arena_free(arena);
+}
+
+/**
+ * Arena_reset frees all but one ordinary chunk, which the next allocations
+ * reuse from its start.
+ */
+static void check_reset(void) {
+	Arena arena = new_Arena(4096);
+	for (int i=0; i < 10; i++) {
+		Arena_malloc(arena, 1000);
+	}
+	Arena_malloc(arena, 3000);
+	Arena_reset(arena);
+	struct Chunk *kept = arena->chunks;
+	check(kept != NULL && kept->next == NULL && kept->size == 4096 && kept->used == 0 && arena->last == NULL,
+		"Arena_reset keeps one empty chunk");
+	char *p = Arena_malloc(arena, 100);
+	check(arena->chunks == kept && p == (char*)kept + HEADER, "allocations after Arena_reset reuse it");
+	Arena_reset(arena);
+	Arena_reset(arena);
+	check(arena->chunks == kept, "Arena_reset of an empty Arena keeps its chunk");
+	Arena_free(arena);
+}
+
+int main(int argc, char **argv) {
+	check_realloc();
+	check_big();
+	check_reset();
+	return failures>0;
+}
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * File: Arena.h
+ *
+ * An Arena hands out memory from large chunks by bumping a pointer, and
+ * gives it all back at once when the Arena is freed or reset. Things built
+ * together and thrown away together (an automaton and its sets, or the
+ * working storage of a conversion) can be allocated from one Arena instead
+ * of with one malloc() and free() each.
+ *
+ * Every function here also accepts a NULL Arena, and then simply uses
+ * malloc(), realloc() and free(). That lets the data structures take an
+ * optional Arena without caring whether they were given one.
+ */
+
+#ifndef _Arena_h
+#define _Arena_h
+
+#include <stddef.h>
+
+// Partial declaration
+typedef struct Arena* Arena;
+
+/**
+ * Allocate, initialize and return a new (empty) Arena that gets memory
+ * from the system in chunks of (at least) the given size, or a default
+ * size if it is 0.
+ */
+extern Arena new_Arena(size_t chunk_size);
+
+/**
+ * Free the given Arena and all the memory allocated from it.
+ */
+extern void Arena_free(Arena this);
+
+/**
+ * Give back all the memory allocated from the given Arena at once, but
+ * keep a chunk of it to be reused by later allocations.
+ */
+extern void Arena_reset(Arena this);
+
+/**
+ * Return size bytes from the given Arena (or from malloc() if it is NULL),
+ * suitably aligned for any type.
+ */
+extern void *Arena_malloc(Arena this, size_t size);
+
+/**
+ * Like Arena_malloc(), but for count elements of the given size, set to 0.
+ */
+extern void *Arena_calloc(Arena this, size_t count, size_t size);
+
+/**
+ * Return memory of new_size bytes holding the first bytes of the given
+ * memory of old_size bytes from the same Arena (or realloc() it if the
+ * Arena is NULL). The most recent allocation is grown in place if there
+ * is room.
+ */
+extern void *Arena_realloc(Arena this, void *p, size_t old_size, size_t new_size);
+
+/**
+ * Release the given memory from the given Arena. This does nothing (the
+ * memory comes back with the rest of the Arena) unless the Arena is NULL,
+ * in which case the memory is free()'d.
+ */
+extern void Arena_release(Arena this, void *p);
+
+#endif
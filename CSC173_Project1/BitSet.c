@@ -4,39 +4,90 @@
  * Created: Thu Aug  3 17:36:24 2017
  * Time-stamp: <Sun Aug  5 12:14:02 EDT 2018 ferguson>
  *
- * A BitSet represents a set of integers using bits of an int.
- * This makes most of the set operations constant-time.
- * The maximum value that can be stored in the set is limited
- * by the number of bits in the biggest int we can get
- * (typically 64, sometimes 32).
+ * A BitSet represents a set of integers using the bits of an array of
+ * words, sized when the set is created. The whole-set operations work a
+ * word (or, with SSE2, two words) at a time, which makes them fast for
+ * sets of up to a few hundred elements.
  */
 #include <stdlib.h>
 #include <stdio.h>
 #include "BitSet.h"
 
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
 // Use the longest int we can get
 typedef unsigned long long int bitset_t;
 
 #define NUMBITS (sizeof(bitset_t) * 8)
 
+// Words are allocated in pairs so the SSE2 loops need no scalar tail
+#define WORDS_PER_VECTOR 2
+
 struct BitSet {
-	bitset_t bits;
+	Arena arena;	// Where the set's memory comes from (NULL for malloc)
+	int nwords;
+	bitset_t *bits;
 };
 
 /**
- * Return the largest value that can be stored in a BitSet.
+ * Return the number of 1 bits in the given word.
+ */
+static int BitSet_popcount(bitset_t word) {
+#if defined(__GNUC__)
+	return __builtin_popcountll(word);
+#else
+	int n = 0;
+	for (; word != 0; word &= word - 1) {
+		n += 1;
+	}
+	return n;
+#endif
+}
+
+/**
+ * Return the index of the lowest 1 bit in the given (nonzero) word.
+ */
+static int BitSet_lowestBit(bitset_t word) {
+#if defined(__GNUC__)
+	return __builtin_ctzll(word);
+#else
+	int i = 0;
+	while ((word & 1) == 0) {
+		word >>= 1;
+		i += 1;
+	}
+	return i;
+#endif
+}
+
+/**
+ * Return the largest value that can be stored in the given BitSet.
  * BitSets can store elements with values from 0 to this value.
  */
-int BitSet_maxValue() {
-	return NUMBITS - 1;
+int BitSet_maxValue(const BitSet this) {
+	return this->nwords * NUMBITS - 1;
 }
 
 /**
- * Allocate, initialize and return a new (empty) BitSet.
+ * Allocate, initialize and return a new (empty) BitSet that can store
+ * the elements 0 to size-1 (and possibly a few more).
  */
-BitSet new_BitSet() {
-	BitSet this = (BitSet)malloc(sizeof(struct BitSet));
-	this->bits = 0;
+BitSet new_BitSet(int size) {
+	return new_BitSet_in(NULL, size);
+}
+
+/**
+ * Allocate, initialize and return a new (empty) BitSet like new_BitSet(),
+ * whose memory comes from the given Arena.
+ */
+BitSet new_BitSet_in(Arena arena, int size) {
+	BitSet this = (BitSet)Arena_malloc(arena, sizeof(struct BitSet));
+	this->arena = arena;
+	int nwords = size > 0 ? (size + NUMBITS - 1) / NUMBITS : 1;
+	this->nwords = (nwords + WORDS_PER_VECTOR - 1) / WORDS_PER_VECTOR * WORDS_PER_VECTOR;
+	this->bits = (bitset_t*)Arena_calloc(arena, this->nwords, sizeof(bitset_t));
 	return this;
 }
 
@@ -45,15 +96,45 @@ BitSet new_BitSet() {
  */
 void BitSet_free(BitSet this) {
 	if (this) {
-		free(this);
+		Arena_release(this->arena, this->bits);
+		Arena_release(this->arena, this);
 	}
 }
 
+/**
+ * Return true if none of the words from..nwords-1 of the given BitSet
+ * has any bits set.
+ */
+static bool BitSet_zeroFrom(const BitSet this, int from) {
+	for (int i=from; i < this->nwords; i++) {
+		if (this->bits[i] != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Return the smaller of the two BitSets' word counts.
+ */
+static int BitSet_commonWords(const BitSet this, const BitSet other) {
+	return this->nwords < other->nwords ? this->nwords : other->nwords;
+}
+
 /**
  * Return true if the given BitSet is empty.
  */
 bool BitSet_isEmpty(const BitSet set) {
-	return set->bits == 0;
+	int i = 0;
+#ifdef __SSE2__
+	__m128i any = _mm_setzero_si128();
+	for (; i < set->nwords; i += WORDS_PER_VECTOR) {
+		any = _mm_or_si128(any, _mm_loadu_si128((const __m128i*)(set->bits + i)));
+	}
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) == 0xFFFF;
+#else
+	return BitSet_zeroFrom(set, i);
+#endif
 }
 
 /**
@@ -61,11 +142,11 @@ bool BitSet_isEmpty(const BitSet set) {
  */
 void BitSet_insert(BitSet set, int element) {
 	// Range check
-	if (element < 0 || element >= NUMBITS) {
+	if (element < 0 || element > BitSet_maxValue(set)) {
 		fprintf(stderr, "BitSet_insert: element out of range: %d\n", element);
 		abort();
 	}
-	set->bits |= (1L << element);
+	set->bits[element / NUMBITS] |= (bitset_t)1 << (element % NUMBITS);
 }
 
 /**
@@ -73,20 +154,36 @@ void BitSet_insert(BitSet set, int element) {
  */
 bool BitSet_lookup(const BitSet this, int element) {
 	// Range check
-	if (element < 0 || element >= NUMBITS) {
+	if (element < 0 || element > BitSet_maxValue(this)) {
 		fprintf(stderr, "BitSet_lookup: element out of range: %d\n", element);
 		abort();
 	}
-	return this->bits & (1L << element);
+	return (this->bits[element / NUMBITS] >> (element % NUMBITS)) & 1;
 }
 
 /**
  * Add the contents of the second BitSet to the first BitSet (adding those elements
  * that aren't already in set1). This will modify the first set unless the second
  * set is empty or all its elements are already in in the first set.
+ * The second set may not contain elements too large for the first.
  */
 void BitSet_union(BitSet this, const BitSet other) {
-	this->bits |= other->bits;
+	int n = BitSet_commonWords(this, other);
+	if (!BitSet_zeroFrom(other, n)) {
+		fprintf(stderr, "BitSet_union: element out of range\n");
+		abort();
+	}
+	int i = 0;
+#ifdef __SSE2__
+	for (; i < n; i += WORDS_PER_VECTOR) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(this->bits + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(other->bits + i));
+		_mm_storeu_si128((__m128i*)(this->bits + i), _mm_or_si128(a, b));
+	}
+#endif
+	for (; i < n; i++) {
+		this->bits[i] |= other->bits[i];
+	}
 }
 
 /**
@@ -94,7 +191,24 @@ void BitSet_union(BitSet this, const BitSet other) {
  * BitSet.
  */
 bool BitSet_containsAll(BitSet this, BitSet other) {
-	return (this->bits | other->bits) == this->bits;
+	int n = BitSet_commonWords(this, other);
+	int i = 0;
+#ifdef __SSE2__
+	for (; i < n; i += WORDS_PER_VECTOR) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(this->bits + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(other->bits + i));
+		__m128i missing = _mm_andnot_si128(a, b);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) != 0xFFFF) {
+			return false;
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		if ((other->bits[i] & ~this->bits[i]) != 0) {
+			return false;
+		}
+	}
+	return BitSet_zeroFrom(other, n);
 }
 
 /**
@@ -102,7 +216,60 @@ bool BitSet_containsAll(BitSet this, BitSet other) {
  * otherwise false.
  */
 bool BitSet_equals(BitSet this, BitSet other) {
-	return this->bits == other->bits;
+	int n = BitSet_commonWords(this, other);
+	int i = 0;
+#ifdef __SSE2__
+	for (; i < n; i += WORDS_PER_VECTOR) {
+		__m128i a = _mm_loadu_si128((const __m128i*)(this->bits + i));
+		__m128i b = _mm_loadu_si128((const __m128i*)(other->bits + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, b)) != 0xFFFF) {
+			return false;
+		}
+	}
+#endif
+	for (; i < n; i++) {
+		if (this->bits[i] != other->bits[i]) {
+			return false;
+		}
+	}
+	return BitSet_zeroFrom(this, n) && BitSet_zeroFrom(other, n);
+}
+
+/**
+ * Return the number of elements in the given BitSet.
+ */
+int BitSet_count(const BitSet this) {
+	int count = 0;
+	for (int i=0; i < this->nwords; i++) {
+		count += BitSet_popcount(this->bits[i]);
+	}
+	return count;
+}
+
+/**
+ * Return the number of bytes of memory used by the given BitSet, counting
+ * its struct and its words.
+ */
+size_t BitSet_bytes(const BitSet this) {
+	return sizeof(struct BitSet) + (size_t)this->nwords * sizeof(bitset_t);
+}
+
+/**
+ * Return a hash code for the given BitSet. Equal BitSets have the same
+ * hash code, even if they were created with different sizes.
+ */
+unsigned BitSet_hash(const BitSet this) {
+	bitset_t hash = 0;
+	for (int i=0; i < this->nwords; i++) {
+		if (this->bits[i] != 0) {
+			bitset_t x = this->bits[i] ^ ((bitset_t)i * 0x9e3779b97f4a7c15ULL);
+			x ^= x >> 33;
+			x *= 0xff51afd7ed558ccdULL;
+			x ^= x >> 33;
+			hash ^= x;
+		}
+	}
+	return (unsigned)(hash ^ (hash >> 32));
 }
 
 /**
@@ -110,16 +277,17 @@ bool BitSet_equals(BitSet this, BitSet other) {
  * element (int) to the function.
  */
 void BitSet_iterate(const BitSet this, void (*func)(int)) {
-	for (int i=0; i < NUMBITS; i++) {
-		if (BitSet_lookup(this, i)) {
-			func(i);
+	for (int i=0; i < this->nwords; i++) {
+		for (bitset_t word = this->bits[i]; word != 0; word &= word - 1) {
+			func(i * NUMBITS + BitSet_lowestBit(word));
 		}
 	}
 }
 
 struct BitSetIterator {
 	BitSet set;
-	int index;
+	int index;	// index of the word being iterated
+	bitset_t word;	// bits of that word not returned yet
 };
 
 /**
@@ -130,6 +298,7 @@ BitSetIterator BitSet_iterator(const BitSet this) {
 	BitSetIterator iterator = (BitSetIterator)malloc(sizeof(struct BitSetIterator));
 	iterator->set = this;
 	iterator->index = 0;
+	iterator->word = this->bits[0];
 	return iterator;
 }
 
@@ -137,17 +306,17 @@ BitSetIterator BitSet_iterator(const BitSet this) {
  * Return true if the next call to BitSetIterator_next on the given
  * BitSetIterator will not fail.
  * Note that this function changes the iterator, advancing it to the
- * next 1 bit (or the end of the set).
+ * next nonzero word (or the end of the set).
  */
 bool BitSetIterator_hasNext(BitSetIterator this) {
-	while (this->index < NUMBITS) {
-		if (BitSet_lookup(this->set, this->index)) {
-			return true;
-		} else {
-			this->index += 1;
+	while (this->word == 0) {
+		if (this->index + 1 >= this->set->nwords) {
+			return false;
 		}
+		this->index += 1;
+		this->word = this->set->bits[this->index];
 	}
-	return false;
+	return true;
 }
 
 /**
@@ -156,9 +325,8 @@ bool BitSetIterator_hasNext(BitSetIterator this) {
  */
 int BitSetIterator_next(BitSetIterator this) {
 	if (BitSetIterator_hasNext(this)) {
-		// iterator index will point to next 1 bit
-		int value = this->index;
-		this->index += 1;
+		int value = this->index * NUMBITS + BitSet_lowestBit(this->word);
+		this->word &= this->word - 1;
 		return value;
 	} else {
 		return -1;
@@ -167,22 +335,21 @@ int BitSetIterator_next(BitSetIterator this) {
 
 /**
  * Print the given BitSet to stdout.
- * Note that this allocates an
  */
 void
 BitSet_print(BitSet this) {
 	printf("{");
 	bool firstElement = true;
-	for (int i=0; i < NUMBITS; i++) {
-		if (BitSet_lookup(this, i)) {
-			if (!firstElement) {
-				printf(",");
-			} else {
-				firstElement = false;
-			}
-			printf("%d", i);
+	BitSetIterator iterator = BitSet_iterator(this);
+	while (BitSetIterator_hasNext(iterator)) {
+		if (!firstElement) {
+			printf(",");
+		} else {
+			firstElement = false;
 		}
+		printf("%d", BitSetIterator_next(iterator));
 	}
+	free(iterator);
 	printf("}");
 }
 
@@ -225,7 +392,8 @@ static void callback(int element) {
 
 int main(int argc, char* argv[]) {
 	printf("creating initial set...\n");
-	BitSet set1 = new_BitSet();
+	BitSet set1 = new_BitSet(200);
+	printf("max value: %d\n", BitSet_maxValue(set1));
 	printf("testing insert...\n");
 	BitSet_insert(set1, 0);
 	BitSet_insert(set1, 1);
@@ -265,7 +433,7 @@ int main(int argc, char* argv[]) {
 	printf("freeing iterator\n");
 	free(iterator);
 	printf("creating new set...\n");
-	BitSet set2 = new_BitSet();
+	BitSet set2 = new_BitSet(200);
 	BitSet_insert(set2, 0);
 	BitSet_insert(set2, 1);
 	BitSet_insert(set2, 2);
@@ -273,6 +441,8 @@ int main(int argc, char* argv[]) {
 	printf("\n");
 	printf("set1 equals set2? %d\n", BitSet_equals(set1, set2));
 	printf("set2 equals set1? %d\n", BitSet_equals(set2, set1));
+	printf("set1 containsAll set2? %d\n", BitSet_containsAll(set1, set2));
+	printf("set2 containsAll set1? %d\n", BitSet_containsAll(set2, set1));
 	BitSet_insert(set2, 3);
 	BitSet_insert(set2, 4);
 	BitSet_insert(set2, 5); // index 0
@@ -282,14 +452,25 @@ int main(int argc, char* argv[]) {
 	printf("\n");
 	printf("set1 equals set2? %d\n", BitSet_equals(set1, set2));
 	printf("set2 equals set1? %d\n", BitSet_equals(set2, set1));
+	printf("hashes equal? %d\n", BitSet_hash(set1) == BitSet_hash(set2));
 	printf("testing set1 with more elements...\n");
-	for (int i=8; i < NUMBITS; i+=2) {
+	for (int i=8; i < 200; i+=2) {
 		BitSet_insert(set1, i);
 	}
 	BitSet_print(set1);
 	printf("\n");
+	printf("count: %d\n", BitSet_count(set1));
 	printf("lookup 48: %d\n", BitSet_lookup(set1, 48));
 	printf("lookup 49: %d\n", BitSet_lookup(set1, 49));
+	printf("lookup 150: %d\n", BitSet_lookup(set1, 150));
+	printf("lookup 151: %d\n", BitSet_lookup(set1, 151));
+	printf("testing union...\n");
+	BitSet set3 = new_BitSet(70);
+	BitSet_insert(set3, 65);
+	BitSet_union(set2, set3);
+	BitSet_print(set2);
+	printf("\n");
+	printf("set1 containsAll set2? %d\n", BitSet_containsAll(set1, set2));
 	printf("testing toString...\n");
 	char *s1 = BitSet_toString(set1);
 	printf("s1=\"%s\"\n", s1);
@@ -297,9 +478,10 @@ int main(int argc, char* argv[]) {
 	char *s2 = BitSet_toString(set2);
 	printf("s2=\"%s\"\n", s2);
 	free(s2);
-	printf("freeing both sets\n");
+	printf("freeing sets\n");
 	BitSet_free(set1);
 	BitSet_free(set2);
+	BitSet_free(set3);
 }
 
 #endif
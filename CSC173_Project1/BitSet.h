@@ -4,30 +4,37 @@
  * Created: Fri Jul  1 09:41:51 2016
  * Time-stamp: <Fri Aug  4 09:31:27 EDT 2017 ferguson>
  *
- * A BitSet represents a set of integers using bits of an int.
- * This makes most of the set operations constant-time.
- * The maximum value that can be stored in the set is limited
- * by the number of bits in the biggest int we can get
- * (typically 64, sometimes 32).
+ * A BitSet represents a set of integers using the bits of an array of
+ * words, sized when the set is created. The whole-set operations work a
+ * word (or, with SSE2, two words) at a time, which makes them fast for
+ * sets of up to a few hundred elements.
  */
 
 #ifndef _BitSet_h
 #define _BitSet_h
 
 #include <stdbool.h>
+#include "Arena.h"
 
 typedef struct BitSet* BitSet;
 
 /**
- * Return the largest value that can be stored in a BitSet.
+ * Return the largest value that can be stored in the given BitSet.
  * BitSets can store elements with values from 0 to this value.
  */
-extern int BitSet_maxValue();
+extern int BitSet_maxValue(const BitSet this);
 
 /**
- * Allocate, initialize and return a new (empty) BitSet.
+ * Allocate, initialize and return a new (empty) BitSet that can store
+ * the elements 0 to size-1 (and possibly a few more).
  */
-extern BitSet new_BitSet();
+extern BitSet new_BitSet(int size);
+
+/**
+ * Allocate, initialize and return a new (empty) BitSet like new_BitSet(),
+ * whose memory comes from the given Arena.
+ */
+extern BitSet new_BitSet_in(Arena arena, int size);
 
 /**
  * Free the memory used for the given Bitset.
@@ -41,8 +48,7 @@ extern bool BitSet_isEmpty(const BitSet this);
 
 /**
  * Add given element (int) to the given BitSet (if it's not already there).
- * The maximum element value that can be stored in a BitSet is limited
- * by the number of bits in a long int (typically 64, sometimes 32).
+ * The element must be no larger than BitSet_maxValue() of the set.
  */
 extern void BitSet_insert(BitSet this, int value);
 
@@ -55,6 +61,7 @@ extern bool BitSet_lookup(const BitSet this, int value);
  * Add the contents of the second BitSet to the first BitSet (adding those elements
  * that aren't already in set1). This will modify the first set unless the second
  * set is empty or all its elements are already in in the first set.
+ * The second set may not contain elements too large for the first.
  */
 extern void BitSet_union(BitSet this, const BitSet other);
 
@@ -70,11 +77,27 @@ extern bool BitSet_containsAll(BitSet this, BitSet other);
  */
 extern bool BitSet_equals(BitSet this, BitSet other);
 
+/**
+ * Return the number of elements in the given BitSet.
+ */
+extern int BitSet_count(const BitSet this);
+
+/**
+ * Return the number of bytes of memory used by the given BitSet.
+ */
+extern size_t BitSet_bytes(const BitSet this);
+
+/**
+ * Return a hash code for the given BitSet. Equal BitSets have the same
+ * hash code, even if they were created with different sizes.
+ */
+extern unsigned BitSet_hash(const BitSet this);
+
 /**
  * Call the given function on each element of given BitSet, passing the
  * int value to the function.
  */
-extern void IntSet_iterate(const BitSet this, void (*func)(int));
+extern void BitSet_iterate(const BitSet this, void (*func)(int));
 
 typedef struct BitSetIterator *BitSetIterator;
 
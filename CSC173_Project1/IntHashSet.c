@@ -5,12 +5,13 @@
  * Hashtable implementation of a set of ints.
  * @see FOCS pp. 360-363, 415
  *
- * This is a weak example of a set implementation.
- * It doesn't do anything smart about set operations other
- * than making it easy to add an element (int) to the set.
- * And it isn't very smart about that either, to be honest.
- *
- * YOU could probably do better...
+ * The elements are kept in one array in the order they were added,
+ * which is what iteration, union and printing walk over. Small sets (most
+ * of the sets of NFA states) keep that array inside the IntHashSet itself
+ * and are searched linearly. Once a set outgrows it, the elements move to
+ * the heap and an open-addressed index (power-of-two size, linear probing)
+ * maps each element to its position in the array. The index is doubled
+ * whenever it gets half full, so a set never needs a malloc per element.
  */
 #include <stdlib.h>
 #include <stdbool.h>
@@ -19,39 +20,44 @@
 
 #include "IntHashSet.h"
 
-struct Node {
-	int element;
-	struct Node* next;
-};
-typedef struct Node Node;
+#define EMPTY -1
+#define SMALL 8
 
 struct IntHashSet {
-	int size;
-	Node** buckets; // Array of pointers to first node in list for bucket
+	Arena arena;	// Where the set's memory comes from (NULL for malloc)
+	int capacity;	// Room in elements
+	int* elements;	// Elements in the order they were added (small or the heap)
 	int count;
+	int size;	// Size of index (a power of 2), or 0 while the set is small
+	int* index;	// Position of each element in elements, or EMPTY
+	unsigned hash;  // Cached IntHashSet_hash(), updated as elements are added
+	int small[SMALL];	// Elements of a small set
 };
 
-static Node* new_Node(int element) {
-	Node* this = (Node*)malloc(sizeof(struct Node));
-	this->element = element;
-	this->next = NULL;
-	return this;
+/**
+ * Allocate and return a new empty IntHashSet. The size is ignored: sets
+ * start small and grow as needed.
+ */
+IntHashSet new_IntHashSet(int size) {
+	return new_IntHashSet_in(NULL, size);
 }
 
 /**
- * Allocate and return a new empty IntHashSet.
+ * Allocate and return a new empty IntHashSet whose memory comes from the
+ * given Arena (see new_IntHashSet).
  */
-IntHashSet new_IntHashSet(int size) {
-	IntHashSet this = (IntHashSet)malloc(sizeof(struct IntHashSet));
+IntHashSet new_IntHashSet_in(Arena arena, int size) {
+	IntHashSet this = (IntHashSet)Arena_malloc(arena, sizeof(struct IntHashSet));
 	if (this == NULL) {
 		return NULL;
 	}
-	this->size = size;
-	this->buckets = (Node**)calloc(size, sizeof(Node*));
-	for (int i=0; i < size; i++) {
-		this->buckets[i] = NULL;
-	}
+	this->arena = arena;
+	this->capacity = SMALL;
+	this->elements = this->small;
 	this->count = 0;
+	this->size = 0;
+	this->index = NULL;
+	this->hash = 0;
 	return this;
 }
 
@@ -62,53 +68,63 @@ void IntHashSet_free(IntHashSet this) {
 	if (this == NULL) {
 		return;
 	}
-	// Free all the nodes
-	for (int index=0; index < this->size; index++) {
-		Node* p = this->buckets[index];
-		while (p != NULL) {
-			Node* next = p->next;
-			free(p);
-			p = next;
-		}
+	if (this->elements != this->small) {
+		Arena_release(this->arena, this->elements);
 	}
-	// Free the hashtable (array of bucket list headers) itself
-	free(this->buckets);
-	// Free the struct
-	free(this);
+	Arena_release(this->arena, this->index);
+	Arena_release(this->arena, this);
 }
 
 /**
- * Very simple hash function for IntHashSet.
- * @see FOCS p415.
+ * Scramble the bits of an element, both to place it in the index and
+ * for IntHashSet_hash().
  */
-static int IntHashSet_hash(IntHashSet this, int element) {
-	int index = element % this->size;
-	return index;
+static unsigned IntHashSet_mix(int element) {
+	unsigned x = (unsigned)element;
+	x = (x ^ (x >> 16)) * 0x45d9f3bu;
+	x = (x ^ (x >> 16)) * 0x45d9f3bu;
+	return x ^ (x >> 16);
 }
 
 /**
- * Insert the given element (int) into the Node list
- * pointed to by pL. That is, pL is the address of a Node.
- * If that address contains NULL, then this is the place
- * to add the element, so fill that address with a new Node.
- * Otherwise, pL points to a Node. If that Node's element
- * is the same as i, then i is already in the set and there
- * is nothing to do. Otherwise, try the next node in the list.
- * @see FOCS Fig 7.14 p. 365
- * We return true if the element was added or false if it was
- * already there, to support keeping track of the count of elements.
+ * Return the slot of the index that holds the given element, or the
+ * empty slot where it would go if it isn't in the given IntHashSet.
  */
-static bool IntHashSet_bucketInsert(int element, Node** pL) {
-	if ((*pL) == NULL) {
-		// Not found in bucket: append
-		(*pL) = new_Node(element);
-		return true; // Yes added
-	} else if ((*pL)->element == element) {
-		// Found in bucket
-		return false; // Not added
-	} else {
-		// Keep searching bucket
-		return IntHashSet_bucketInsert(element, &((*pL)->next));
+static int IntHashSet_slot(IntHashSet this, int element) {
+	int mask = this->size - 1;
+	int i = IntHashSet_mix(element) & mask;
+	while (this->index[i] != EMPTY && this->elements[this->index[i]] != element) {
+		i = (i+1) & mask;
+	}
+	return i;
+}
+
+/**
+ * Return the position in elements of the given element of a small
+ * IntHashSet, or EMPTY if it isn't there.
+ */
+static int IntHashSet_smallFind(IntHashSet this, int element) {
+	for (int n=0; n < this->count; n++) {
+		if (this->elements[n] == element) {
+			return n;
+		}
+	}
+	return EMPTY;
+}
+
+/**
+ * Double the size of the index of the given IntHashSet (or give a small
+ * set its first index) and put every element back in it.
+ */
+static void IntHashSet_grow(IntHashSet this) {
+	Arena_release(this->arena, this->index);
+	this->size = this->size == 0 ? 4 * SMALL : 2 * this->size;
+	this->index = (int*)Arena_malloc(this->arena, this->size * sizeof(int));
+	for (int i=0; i < this->size; i++) {
+		this->index[i] = EMPTY;
+	}
+	for (int n=0; n < this->count; n++) {
+		this->index[IntHashSet_slot(this, this->elements[n])] = n;
 	}
 }
 
@@ -117,9 +133,36 @@ static bool IntHashSet_bucketInsert(int element, Node** pL) {
  * it isn't already present.
  */
 void IntHashSet_insert(IntHashSet this, int element) {
-	int index = IntHashSet_hash(this, element);
-	if (IntHashSet_bucketInsert(element, &(this->buckets[index]))) {
-		this->count += 1;
+	if (this->index == NULL) {
+		if (IntHashSet_smallFind(this, element) != EMPTY) {
+			return;
+		}
+		if (this->count < SMALL) {
+			this->elements[this->count++] = element;
+			this->hash += IntHashSet_mix(element);
+			return;
+		}
+		// Too big to stay small: move the elements to the heap
+		this->capacity = 2 * SMALL;
+		this->elements = (int*)Arena_malloc(this->arena, this->capacity * sizeof(int));
+		memcpy(this->elements, this->small, SMALL * sizeof(int));
+		IntHashSet_grow(this);
+	}
+	int i = IntHashSet_slot(this, element);
+	if (this->index[i] != EMPTY) {
+		return;
+	}
+	if (this->count == this->capacity) {
+		this->elements = (int*)Arena_realloc(this->arena, this->elements, this->capacity * sizeof(int), 2 * this->capacity * sizeof(int));
+		this->capacity *= 2;
+	}
+	int n = this->count++;
+	this->elements[n] = element;
+	this->hash += IntHashSet_mix(element);
+	if (2 * this->count > this->size) {
+		IntHashSet_grow(this);
+	} else {
+		this->index[i] = n;
 	}
 }
 
@@ -128,13 +171,10 @@ void IntHashSet_insert(IntHashSet this, int element) {
  * otherwise false.
  */
 bool IntHashSet_lookup(IntHashSet this, int element) {
-	int index = IntHashSet_hash(this, element);
-	for (Node* p=this->buckets[index]; p != NULL; p=p->next) {
-		if (p->element == element) {
-			return true;
-		}
+	if (this->index == NULL) {
+		return IntHashSet_smallFind(this, element) != EMPTY;
 	}
-	return false;
+	return this->index[IntHashSet_slot(this, element)] != EMPTY;
 }
 
 /**
@@ -145,11 +185,8 @@ bool IntHashSet_lookup(IntHashSet this, int element) {
  */
 void IntHashSet_union(IntHashSet this, const IntHashSet other) {
 	// Iterate over elements of other set, adding to this set
-	for (int index=0; index < other->size; index++) {
-		for (Node* p=other->buckets[index]; p != NULL; p=p->next) {
-			int element = p->element;
-			IntHashSet_insert(this, element);
-		}
+	for (int n=0; n < other->count; n++) {
+		IntHashSet_insert(this, other->elements[n]);
 	}
 }
 
@@ -158,15 +195,10 @@ void IntHashSet_union(IntHashSet this, const IntHashSet other) {
  */
 void IntHashSet_print(IntHashSet this) {
 	printf("{");
-	int n = 0;
-	for (int index=0; index < this->size; index++) {
-		for (Node* p=this->buckets[index]; p != NULL; p=p->next) {
-			int element = p->element;
-			printf("%d", element);
-			n += 1;
-			if (n < this->count) {
-				printf(",");
-			}
+	for (int n=0; n < this->count; n++) {
+		printf("%d", this->elements[n]);
+		if (n+1 < this->count) {
+			printf(",");
 		}
 	}
 	printf("}");
@@ -180,6 +212,19 @@ int IntHashSet_count(IntHashSet this) {
 	return this->count;
 }
 
+/**
+ * Return the number of bytes of memory used by the given IntHashSet,
+ * counting its struct, its elements once they outgrow the struct, and
+ * its index.
+ */
+size_t IntHashSet_bytes(IntHashSet this) {
+	size_t bytes = sizeof(struct IntHashSet) + (size_t)this->size * sizeof(int);
+	if (this->elements != this->small) {
+		bytes += (size_t)this->capacity * sizeof(int);
+	}
+	return bytes;
+}
+
 /**
  * Return true if this IntHashSet is empty (contains no elements).
  */
@@ -197,30 +242,36 @@ bool IntHashSet_equals(IntHashSet this, IntHashSet other) {
 	if (this->count != other->count) {
 		return false;
 	}
+	// So may the cached hashes
+	if (this->hash != other->hash) {
+		return false;
+	}
 	// Otherwise have to scan and test each element
-	// You might be able to figure out which is better to scan over...
-	for (int index=0; index < this->size; index++) {
-		for (Node* p=this->buckets[index]; p != NULL; p=p->next) {
-			int element = p->element;
-			if (!IntHashSet_lookup(other, element)) {
-				return false;
-			}
+	for (int n=0; n < this->count; n++) {
+		if (!IntHashSet_lookup(other, this->elements[n])) {
+			return false;
 		}
 	}
 	return true;
 }
 
+/**
+ * Return a hash code for the given IntHashSet. Sets with the same
+ * elements have the same hash code, however they were built. The hash
+ * is kept up to date as elements are added, so this is constant-time.
+ */
+unsigned IntHashSet_hash(IntHashSet this) {
+	return this->hash;
+}
+
 /**
  * Call the given function on each element of the given
  * IntHashSet, calling the given function on each int value
  * one after the other.
  */
 void IntHashSet_iterate(const IntHashSet this, void (*func)(int)) {
-	for (int index=0; index < this->size; index++) {
-		for (Node* p=this->buckets[index]; p != NULL; p=p->next) {
-			int element = p->element;
-			func(element);
-		}
+	for (int n=0; n < this->count; n++) {
+		func(this->elements[n]);
 	}
 }
 
@@ -230,9 +281,7 @@ void IntHashSet_iterate(const IntHashSet this, void (*func)(int)) {
  */
 struct IntHashSetIterator {
 	IntHashSet set;
-	int count;
-	int index;	// bucket
-	Node *node;	// Node within bucket
+	int count;	// Position of the next element
 };
 
 /**
@@ -243,8 +292,6 @@ IntHashSetIterator IntHashSet_iterator(const IntHashSet this) {
 	IntHashSetIterator iterator = (IntHashSetIterator)malloc(sizeof(struct IntHashSetIterator));
 	iterator->set = this;
 	iterator->count = 0;
-	iterator->index = 0;
-	iterator->node = this->buckets[0];
 	return iterator;
 }
 
@@ -262,18 +309,11 @@ bool IntHashSetIterator_hasNext(const IntHashSetIterator this) {
  * -1 could be a value in an IntHashSet).
  */
 int IntHashSetIterator_next(IntHashSetIterator this) {
-	while (this->node == NULL) {
-		if (this->index >= this->set->size) {
-			// Not found!
-			return -1;
-		}
-		this->index += 1;
-		this->node = this->set->buckets[this->index];
+	if (this->count >= this->set->count) {
+		// Not found!
+		return -1;
 	}
-	int element = this->node->element;
-	this->node = this->node->next;
-	this->count += 1;
-	return element;
+	return this->set->elements[this->count++];
 }
 
 /**
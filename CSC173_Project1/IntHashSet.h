@@ -3,18 +3,22 @@
 #define _IntHashSet_h
 
 #include <stdbool.h>
+#include "Arena.h"
 
 typedef struct IntHashSet* IntHashSet;
 
 extern IntHashSet new_IntHashSet(int size);
+extern IntHashSet new_IntHashSet_in(Arena arena, int size);
 extern void IntHashSet_free(IntHashSet this);
 extern void IntHashSet_insert(IntHashSet this, int i);
 extern bool IntHashSet_lookup(IntHashSet this, int i);
 extern void IntHashSet_union(IntHashSet this, const IntHashSet other);
 extern void IntHashSet_print(IntHashSet this);
 extern int IntHashSet_count(IntHashSet this);
+extern size_t IntHashSet_bytes(IntHashSet this);
 extern bool IntHashSet_isEmpty(IntHashSet this);
 extern bool IntHashSet_equals(IntHashSet this, IntHashSet other);
+extern unsigned IntHashSet_hash(IntHashSet this);
 extern void IntHashSet_iterate(const IntHashSet this, void (*func)(int));
 
 typedef struct IntHashSetIterator* IntHashSetIterator;
@@ -23,6 +23,7 @@ struct Node {
  * Linked list with first and last (head and tail) pointers.
  */
 struct LinkedList {
+	Arena arena;	// Where the list and its nodes come from (NULL for malloc)
 	Node first;
 	Node last;
 };
@@ -31,13 +32,22 @@ struct LinkedList {
  * Allocate, initialize and return a new (empty) LinkedList.
  */
 LinkedList new_LinkedList() {
-	LinkedList this = (LinkedList)malloc(sizeof(struct LinkedList));
+	return new_LinkedList_in(NULL);
+}
+
+/**
+ * Allocate, initialize and return a new (empty) LinkedList whose nodes
+ * (but not their data) come from the given Arena.
+ */
+LinkedList new_LinkedList_in(Arena arena) {
+	LinkedList this = (LinkedList)Arena_malloc(arena, sizeof(struct LinkedList));
+	this->arena = arena;
 	this->first = this->last = NULL;
 	return this;
 }
 
-static Node new_Node(void *data) {
-	Node this = (Node)malloc(sizeof(struct Node));
+static Node new_Node(Arena arena, void *data) {
+	Node this = (Node)Arena_malloc(arena, sizeof(struct Node));
 	this->data = data;
 	this->next = this->prev = NULL;
 	return this;
@@ -59,11 +69,11 @@ void LinkedList_free(LinkedList this, bool free_data_also) {
 		if (free_data_also && node->data != NULL) {
 			free(node->data);
 		}
-		free(node);
+		Arena_release(this->arena, node);
 		node = next;
 	}
 	// Free the list itself
-	free(this);
+	Arena_release(this->arena, this);
 }
 
 /**
@@ -77,7 +87,7 @@ bool LinkedList_isEmpty(const LinkedList this) {
  * Add the given void* value at the front of the given LinkedList.
  */
 void LinkedList_add_at_front(LinkedList this, void *data) {
-	Node node = new_Node(data);
+	Node node = new_Node(this->arena, data);
 	node->next = this->first;
 	if (this->first != NULL) {
 		this->first->prev = node;
@@ -92,7 +102,7 @@ void LinkedList_add_at_front(LinkedList this, void *data) {
  * Add the given void* value at the end of the given LinkedList.
  */
 void LinkedList_add_at_end(LinkedList this, void *data) {
-	Node node = new_Node(data);
+	Node node = new_Node(this->arena, data);
 	node->prev = this->last;
 	if (this->last != NULL) {
 		this->last->next = node;
@@ -136,7 +146,7 @@ void LinkedList_remove(LinkedList this, void *data) {
 			if (node->next != NULL) {
 				node->next->prev = node->prev;
 			}
-			free(node);
+			Arena_release(this->arena, node);
 			return;
 		}
 	}
@@ -229,6 +239,115 @@ void* LinkedListIterator_next(LinkedListIterator this) {
 	}
 }
 
+/**
+ * A Worklist's values are data[(first + i) & (capacity - 1)] for i from 0
+ * to count - 1. The capacity is a power of two, doubled when it is full.
+ */
+struct Worklist {
+	Arena arena;	// Where the array comes from (NULL for malloc)
+	void **data;
+	int capacity;
+	int first;
+	int count;
+};
+
+/**
+ * Allocate, initialize and return a new (empty) Worklist.
+ */
+Worklist new_Worklist() {
+	return new_Worklist_in(NULL);
+}
+
+/**
+ * Allocate, initialize and return a new (empty) Worklist whose array comes
+ * from the given Arena.
+ */
+Worklist new_Worklist_in(Arena arena) {
+	Worklist this = (Worklist)Arena_malloc(arena, sizeof(struct Worklist));
+	this->arena = arena;
+	this->capacity = 16;
+	this->data = (void**)Arena_malloc(arena, this->capacity * sizeof(void*));
+	this->first = 0;
+	this->count = 0;
+	return this;
+}
+
+/**
+ * Free the memory used for the given Worklist.
+ * If boolean free_data_also is true, also free the data still in it.
+ */
+void Worklist_free(Worklist this, bool free_data_also) {
+	if (this == NULL) {
+		return;
+	}
+	if (free_data_also) {
+		for (int i=0; i < this->count; i++) {
+			free(Worklist_elementAt(this, i));
+		}
+	}
+	Arena_release(this->arena, this->data);
+	Arena_release(this->arena, this);
+}
+
+/**
+ * Return true if the given Worklist is empty.
+ */
+bool Worklist_isEmpty(const Worklist this) {
+	return this->count == 0;
+}
+
+/**
+ * Return the number of values in the given Worklist.
+ */
+int Worklist_count(const Worklist this) {
+	return this->count;
+}
+
+/**
+ * Add the given void* value at the end of the given Worklist.
+ * When the array is full its values are copied, front first, to the
+ * start of one twice the size.
+ */
+void Worklist_push(Worklist this, void *data) {
+	if (this->count == this->capacity) {
+		void **bigger = (void**)Arena_malloc(this->arena, 2 * this->capacity * sizeof(void*));
+		for (int i=0; i < this->count; i++) {
+			bigger[i] = Worklist_elementAt(this, i);
+		}
+		Arena_release(this->arena, this->data);
+		this->data = bigger;
+		this->capacity *= 2;
+		this->first = 0;
+	}
+	this->data[(this->first + this->count) & (this->capacity - 1)] = data;
+	this->count += 1;
+}
+
+/**
+ * Remove and return the value at the front of the given Worklist, or
+ * NULL if it is empty.
+ */
+void* Worklist_pop(Worklist this) {
+	if (this->count == 0) {
+		return NULL;
+	}
+	void *data = this->data[this->first];
+	this->first = (this->first + 1) & (this->capacity - 1);
+	this->count -= 1;
+	return data;
+}
+
+/**
+ * Return the value at the given position (0 is the front) of the given
+ * Worklist, or NULL if there is no such.
+ */
+void* Worklist_elementAt(const Worklist this, int index) {
+	if (index < 0 || index >= this->count) {
+		return NULL;
+	}
+	return this->data[(this->first + index) & (this->capacity - 1)];
+}
+
 #ifdef MAIN
 
 /**
@@ -294,6 +413,27 @@ int main(int argc, char **argv) {
 
 	printf("freeing list\n");
 	LinkedList_free(list, false);
+
+	printf("testing worklist...\n");
+	Worklist work = new_Worklist();
+	char *names[] = { "a", "b", "c", "d", "e", "f", "g", "h", "i", "j" };
+	for (int round=0; round < 4; round++) {
+		for (int i=0; i < 10; i++) {
+			Worklist_push(work, names[i]);
+		}
+		printf("pushed 10, count %d, element 3 is %s, popped:", Worklist_count(work), (char*)Worklist_elementAt(work, 3));
+		for (int i=0; i < 7; i++) {
+			printf(" %s", (char*)Worklist_pop(work));
+		}
+		printf("\n");
+	}
+	printf("worklist count: %d\n", Worklist_count(work));
+	while (!Worklist_isEmpty(work)) {
+		printf("%s ", (char*)Worklist_pop(work));
+	}
+	printf("\n");
+	printf("freeing worklist\n");
+	Worklist_free(work, false);
 }
 
 #endif
@@ -11,6 +11,7 @@
 #define _LinkedList_h_gf
 
 #include <stdbool.h>
+#include "Arena.h"
 
 // Partial declaration
 typedef struct LinkedList* LinkedList;
@@ -20,6 +21,12 @@ typedef struct LinkedList* LinkedList;
  */
 extern LinkedList new_LinkedList();
 
+/**
+ * Allocate, initialize and return a new (empty) LinkedList whose nodes
+ * (but not their data) come from the given Arena.
+ */
+extern LinkedList new_LinkedList_in(Arena arena);
+
 /**
  * Free the memory used for the given LinkedList.
  * If boolean free_data_also is true, also free the data associated with
@@ -105,4 +112,56 @@ extern void *LinkedListIterator_next(LinkedListIterator iterator);
  */
 extern void LinkedList_print_string_list(LinkedList this);
 
+/**
+ * A Worklist is a first-in first-out queue of void* values kept in a
+ * growable circular array, for when all that's needed is to add at the
+ * end and take from the front: both are constant-time, as is getting the
+ * element at any position, and nothing is allocated per element.
+ */
+typedef struct Worklist* Worklist;
+
+/**
+ * Allocate, initialize and return a new (empty) Worklist.
+ */
+extern Worklist new_Worklist();
+
+/**
+ * Allocate, initialize and return a new (empty) Worklist whose array comes
+ * from the given Arena.
+ */
+extern Worklist new_Worklist_in(Arena arena);
+
+/**
+ * Free the memory used for the given Worklist.
+ * If boolean free_data_also is true, also free the data still in it.
+ */
+extern void Worklist_free(Worklist this, bool free_data_also);
+
+/**
+ * Return true if the given Worklist is empty.
+ */
+extern bool Worklist_isEmpty(const Worklist this);
+
+/**
+ * Return the number of values in the given Worklist.
+ */
+extern int Worklist_count(const Worklist this);
+
+/**
+ * Add the given void* value at the end of the given Worklist.
+ */
+extern void Worklist_push(Worklist this, void *value);
+
+/**
+ * Remove and return the value at the front of the given Worklist, or
+ * NULL if it is empty.
+ */
+extern void *Worklist_pop(Worklist this);
+
+/**
+ * Return the value at the given position (0 is the front) of the given
+ * Worklist, or NULL if there is no such.
+ */
+extern void *Worklist_elementAt(const Worklist this, int index);
+
 #endif
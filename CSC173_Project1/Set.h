@@ -1,21 +1,29 @@
 /**
  * Definitions of the Set type and functions to use either
- * IntHashSet (based on the code in FOCS) or the bit-vector
- * implementation BitSet.
- * Note that the latter will only work if you don't need to
- * store int values greater than 63 (31 on some platforms)
- * in your Sets.
+ * IntHashSet (based on the code in FOCS), the bit-vector
+ * implementation BitSet, or the sorted-array SortedIntSet.
+ * Note that with BitSet, new_Set(N) can only store the
+ * int values 0 to N-1 (rounded up to a whole number of words).
  */
 
+#ifndef _Set_h
+#define _Set_h
+
 //#define USE_BITSET
+//#define USE_SORTEDSET
 
-#ifndef USE_BITSET
+#if !defined(USE_BITSET) && !defined(USE_SORTEDSET)
 # include "IntHashSet.h"
 # define Set IntHashSet
 # define new_Set(N) new_IntHashSet(N)
+# define new_Set_in(A,N) new_IntHashSet_in(A,N)
 # define Set_free IntHashSet_free
 # define Set_isEmpty IntHashSet_isEmpty
 # define Set_insert IntHashSet_insert
+# define Set_lookup IntHashSet_lookup
+# define Set_count IntHashSet_count
+# define Set_bytes IntHashSet_bytes
+# define Set_hash IntHashSet_hash
 # define Set_union IntHashSet_union
 # define Set_equals IntHashSet_equals
 # define Set_print IntHashSet_print
@@ -24,13 +32,18 @@
 # define Set_iterator IntHashSet_iterator
 # define SetIterator_hasNext IntHashSetIterator_hasNext
 # define SetIterator_next IntHashSetIterator_next
-#else
+#elif defined(USE_BITSET)
 # include "BitSet.h"
 # define Set BitSet
-# define new_Set(N) new_BitSet()
+# define new_Set(N) new_BitSet(N)
+# define new_Set_in(A,N) new_BitSet_in(A,N)
 # define Set_free BitSet_free
 # define Set_isEmpty BitSet_isEmpty
 # define Set_insert BitSet_insert
+# define Set_lookup BitSet_lookup
+# define Set_count BitSet_count
+# define Set_bytes BitSet_bytes
+# define Set_hash BitSet_hash
 # define Set_union BitSet_union
 # define Set_equals BitSet_equals
 # define Set_print BitSet_print
@@ -39,4 +52,26 @@
 # define Set_iterator BitSet_iterator
 # define SetIterator_hasNext BitSetIterator_hasNext
 # define SetIterator_next BitSetIterator_next
+#else
+# include "SortedIntSet.h"
+# define Set SortedIntSet
+# define new_Set(N) new_SortedIntSet(4)
+# define new_Set_in(A,N) new_SortedIntSet_in(A,4)
+# define Set_free SortedIntSet_free
+# define Set_isEmpty SortedIntSet_isEmpty
+# define Set_insert SortedIntSet_insert
+# define Set_lookup SortedIntSet_lookup
+# define Set_count SortedIntSet_count
+# define Set_bytes SortedIntSet_bytes
+# define Set_hash SortedIntSet_hash
+# define Set_union SortedIntSet_union
+# define Set_equals SortedIntSet_equals
+# define Set_print SortedIntSet_print
+# define Set_toString SortedIntSet_toString
+# define SetIterator SortedIntSetIterator
+# define Set_iterator SortedIntSet_iterator
+# define SetIterator_hasNext SortedIntSetIterator_hasNext
+# define SetIterator_next SortedIntSetIterator_next
+#endif
+
 #endif
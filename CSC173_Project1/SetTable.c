@@ -0,0 +1,158 @@
+/*
+ * File: SetTable.c
+ *
+ * Sets are kept in an array in the order they were added, and indexed by
+ * an open-addressed hash table (linear probing, power-of-two size) of
+ * positions in that array. Each set's hash is cached by the set itself,
+ * so a probe only compares sets whose hashes match.
+ */
+
+#include <stdlib.h>
+#include "SetTable.h"
+
+struct SetTable {
+	Arena arena;	// Where the table's memory comes from (NULL for malloc)
+	Set* sets;	// Sets in the order they were added
+	unsigned* hashes;	// Their hashes
+	int count;
+	int capacity;
+	int* index;		// Open-addressed hash table of positions in sets, -1 if empty
+	int size;		// Number of slots in index (a power of two)
+};
+
+/**
+ * Allocate, initialize and return a new (empty) SetTable.
+ */
+SetTable new_SetTable() {
+	return new_SetTable_in(NULL);
+}
+
+/**
+ * Allocate, initialize and return a new (empty) SetTable whose own memory
+ * (but not the sets') comes from the given Arena.
+ */
+SetTable new_SetTable_in(Arena arena) {
+	SetTable this = (SetTable)Arena_malloc(arena, sizeof(struct SetTable));
+	this->arena = arena;
+	this->count = 0;
+	this->capacity = 16;
+	this->sets = (Set*)Arena_malloc(arena, this->capacity * sizeof(Set));
+	this->hashes = (unsigned*)Arena_malloc(arena, this->capacity * sizeof(unsigned));
+	this->size = 32;
+	this->index = (int*)Arena_malloc(arena, this->size * sizeof(int));
+	for (int i=0; i < this->size; i++) {
+		this->index[i] = -1;
+	}
+	return this;
+}
+
+/**
+ * Free the memory used for the given SetTable.
+ * If boolean free_sets_also is true, also free the sets in the table.
+ */
+void SetTable_free(SetTable this, bool free_sets_also) {
+	if (this == NULL) {
+		return;
+	}
+	SetTable_clear(this, free_sets_also);
+	Arena_release(this->arena, this->index);
+	Arena_release(this->arena, this->hashes);
+	Arena_release(this->arena, this->sets);
+	Arena_release(this->arena, this);
+}
+
+/**
+ * Remove all the sets from the given SetTable, so that numbering starts
+ * again from 0. If boolean free_sets_also is true, also free the sets.
+ */
+void SetTable_clear(SetTable this, bool free_sets_also) {
+	if (free_sets_also) {
+		for (int i=0; i < this->count; i++) {
+			Set_free(this->sets[i]);
+		}
+	}
+	for (int i=0; i < this->size; i++) {
+		this->index[i] = -1;
+	}
+	this->count = 0;
+}
+
+/**
+ * Return the number of sets in the given SetTable.
+ */
+int SetTable_count(const SetTable this) {
+	return this->count;
+}
+
+/**
+ * Return the number of bytes of memory used by the given SetTable itself:
+ * its struct, the room for sets and their hashes, and its index.
+ */
+size_t SetTable_bytes(const SetTable this) {
+	return sizeof(struct SetTable) + (size_t)this->capacity * (sizeof(Set) + sizeof(unsigned))
+		+ (size_t)this->size * sizeof(int);
+}
+
+/**
+ * Return the number of the set in the given SetTable that is equal to
+ * the given set, or -1 if there is none.
+ */
+int SetTable_lookup(const SetTable this, Set set) {
+	unsigned hash = Set_hash(set);
+	int mask = this->size - 1;
+	for (int i = hash & mask; this->index[i] >= 0; i = (i+1) & mask) {
+		int n = this->index[i];
+		if (this->hashes[n] == hash && Set_equals(this->sets[n], set)) {
+			return n;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Put position n in the first free slot of the index for its hash.
+ */
+static void SetTable_place(SetTable this, int n) {
+	int mask = this->size - 1;
+	int i = this->hashes[n] & mask;
+	while (this->index[i] >= 0) {
+		i = (i+1) & mask;
+	}
+	this->index[i] = n;
+}
+
+/**
+ * Add the given set to the given SetTable and return its number.
+ * The index is doubled whenever it gets half full.
+ */
+int SetTable_add(SetTable this, Set set) {
+	if (this->count == this->capacity) {
+		this->sets = (Set*)Arena_realloc(this->arena, this->sets, this->capacity * sizeof(Set), 2 * this->capacity * sizeof(Set));
+		this->hashes = (unsigned*)Arena_realloc(this->arena, this->hashes, this->capacity * sizeof(unsigned), 2 * this->capacity * sizeof(unsigned));
+		this->capacity *= 2;
+	}
+	int n = this->count++;
+	this->sets[n] = set;
+	this->hashes[n] = Set_hash(set);
+	if (2 * this->count > this->size) {
+		Arena_release(this->arena, this->index);
+		this->size *= 2;
+		this->index = (int*)Arena_malloc(this->arena, this->size * sizeof(int));
+		for (int i=0; i < this->size; i++) {
+			this->index[i] = -1;
+		}
+		for (int m=0; m < this->count; m++) {
+			SetTable_place(this, m);
+		}
+	} else {
+		SetTable_place(this, n);
+	}
+	return n;
+}
+
+/**
+ * Return the set with the given number in the given SetTable.
+ */
+Set SetTable_get(const SetTable this, int index) {
+	return this->sets[index];
+}
@@ -0,0 +1,72 @@
+/*
+ * File: SetTable.h
+ *
+ * A SetTable numbers the distinct Sets added to it 0, 1, 2, ...
+ * in the order they were added, and finds the number of a set equal to a
+ * given one in expected time proportional to the size of the set. This is
+ * what the subset construction needs to name its DFA states.
+ */
+
+#ifndef _SetTable_h
+#define _SetTable_h
+
+#include <stdbool.h>
+#include "Set.h"
+#include "Arena.h"
+
+// Partial declaration
+typedef struct SetTable* SetTable;
+
+/**
+ * Allocate, initialize and return a new (empty) SetTable.
+ */
+extern SetTable new_SetTable();
+
+/**
+ * Allocate, initialize and return a new (empty) SetTable whose own memory
+ * (but not the sets') comes from the given Arena.
+ */
+extern SetTable new_SetTable_in(Arena arena);
+
+/**
+ * Free the memory used for the given SetTable.
+ * If boolean free_sets_also is true, also free the sets in the table.
+ */
+extern void SetTable_free(SetTable this, bool free_sets_also);
+
+/**
+ * Remove all the sets from the given SetTable, so that numbering starts
+ * again from 0. If boolean free_sets_also is true, also free the sets.
+ */
+extern void SetTable_clear(SetTable this, bool free_sets_also);
+
+/**
+ * Return the number of sets in the given SetTable.
+ */
+extern int SetTable_count(const SetTable this);
+
+/**
+ * Return the number of bytes of memory used by the given SetTable itself
+ * (not counting the sets in it).
+ */
+extern size_t SetTable_bytes(const SetTable this);
+
+/**
+ * Return the number of the set in the given SetTable that is equal to
+ * the given set, or -1 if there is none.
+ */
+extern int SetTable_lookup(const SetTable this, Set set);
+
+/**
+ * Add the given set to the given SetTable and return its number, which is
+ * the number of sets in the table before it was added. The set must not
+ * already be in the table, and must not be changed while it is in there.
+ */
+extern int SetTable_add(SetTable this, Set set);
+
+/**
+ * Return the set with the given number in the given SetTable.
+ */
+extern Set SetTable_get(const SetTable this, int index);
+
+#endif
@@ -0,0 +1,358 @@
+/*
+ * File: SortedIntSet.c
+ *
+ * A SortedIntSet represents a set of ints as a sorted array, so that
+ * union is a linear merge and equality is a length check and a memcmp().
+ */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "SortedIntSet.h"
+
+struct SortedIntSet {
+	Arena arena;	// Where the set's memory comes from (NULL for malloc)
+	int count;
+	int capacity;
+	int *elements;	// Sorted, without duplicates
+	bool hashed;	// True when hash is up to date
+	unsigned hash;
+};
+
+/**
+ * Allocate, initialize and return a new (empty) SortedIntSet with room
+ * for size elements before it needs to grow.
+ */
+SortedIntSet new_SortedIntSet(int size) {
+	return new_SortedIntSet_in(NULL, size);
+}
+
+/**
+ * Allocate, initialize and return a new (empty) SortedIntSet like
+ * new_SortedIntSet(), whose memory comes from the given Arena.
+ */
+SortedIntSet new_SortedIntSet_in(Arena arena, int size) {
+	SortedIntSet this = (SortedIntSet)Arena_malloc(arena, sizeof(struct SortedIntSet));
+	this->arena = arena;
+	this->count = 0;
+	this->capacity = size > 0 ? size : 1;
+	this->elements = (int*)Arena_malloc(arena, this->capacity * sizeof(int));
+	this->hashed = false;
+	return this;
+}
+
+/**
+ * Free the memory used for the given SortedIntSet.
+ */
+void SortedIntSet_free(SortedIntSet this) {
+	if (this) {
+		Arena_release(this->arena, this->elements);
+		Arena_release(this->arena, this);
+	}
+}
+
+/**
+ * Make room in the given SortedIntSet for at least the given number of
+ * elements.
+ */
+static void SortedIntSet_reserve(SortedIntSet this, int capacity) {
+	if (capacity > this->capacity) {
+		int old = this->capacity;
+		while (this->capacity < capacity) {
+			this->capacity *= 2;
+		}
+		this->elements = (int*)Arena_realloc(this->arena, this->elements, old * sizeof(int), this->capacity * sizeof(int));
+	}
+}
+
+/**
+ * Return the position of the first element of the given SortedIntSet
+ * that is not less than the given element.
+ */
+static int SortedIntSet_position(const SortedIntSet this, int element) {
+	int lo = 0;
+	int hi = this->count;
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+		if (this->elements[mid] < element) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
+
+/**
+ * Return true if the given SortedIntSet is empty.
+ */
+bool SortedIntSet_isEmpty(const SortedIntSet this) {
+	return this->count == 0;
+}
+
+/**
+ * Return the number of elements in the given SortedIntSet.
+ */
+int SortedIntSet_count(const SortedIntSet this) {
+	return this->count;
+}
+
+/**
+ * Return the number of bytes of memory used by the given SortedIntSet,
+ * counting its struct and the room for its elements.
+ */
+size_t SortedIntSet_bytes(const SortedIntSet this) {
+	return sizeof(struct SortedIntSet) + (size_t)this->capacity * sizeof(int);
+}
+
+/**
+ * Add given element (int) to the given SortedIntSet (if it's not already there).
+ */
+void SortedIntSet_insert(SortedIntSet this, int element) {
+	int i = SortedIntSet_position(this, element);
+	if (i < this->count && this->elements[i] == element) {
+		return;
+	}
+	SortedIntSet_reserve(this, this->count + 1);
+	memmove(this->elements + i + 1, this->elements + i, (this->count - i) * sizeof(int));
+	this->elements[i] = element;
+	this->count += 1;
+	this->hashed = false;
+}
+
+/**
+ * Return true if the given SortedIntSet contains the given element (int).
+ */
+bool SortedIntSet_lookup(const SortedIntSet this, int element) {
+	int i = SortedIntSet_position(this, element);
+	return i < this->count && this->elements[i] == element;
+}
+
+/**
+ * Add the contents of the second SortedIntSet to the first SortedIntSet
+ * (adding those elements that aren't already in set1).
+ * The merge runs from the high end into the first set's own array, so it
+ * needs no other buffer, and the result is then moved down into place.
+ */
+void SortedIntSet_union(SortedIntSet this, const SortedIntSet other) {
+	if (other->count == 0) {
+		return;
+	}
+	this->hashed = false;
+	if (this->count == 0 || this->elements[this->count-1] < other->elements[0]) {
+		// Everything in other comes after everything in this
+		SortedIntSet_reserve(this, this->count + other->count);
+		memcpy(this->elements + this->count, other->elements, other->count * sizeof(int));
+		this->count += other->count;
+		return;
+	}
+	int total = this->count + other->count;
+	SortedIntSet_reserve(this, total);
+	int *elements = this->elements;
+	int i = this->count - 1;
+	int j = other->count - 1;
+	int k = total;
+	while (j >= 0) {
+		if (i >= 0 && elements[i] > other->elements[j]) {
+			elements[--k] = elements[i--];
+		} else if (i >= 0 && elements[i] == other->elements[j]) {
+			elements[--k] = elements[i--];
+			j--;
+		} else {
+			elements[--k] = other->elements[j--];
+		}
+	}
+	// What's left of this is already in place below k
+	int count = (i + 1) + (total - k);
+	if (k != i + 1) {
+		memmove(elements + i + 1, elements + k, (total - k) * sizeof(int));
+	}
+	this->count = count;
+}
+
+/**
+ * Return true if the two given SortedIntSets contain exactly the same
+ * elements, otherwise false.
+ */
+bool SortedIntSet_equals(SortedIntSet this, SortedIntSet other) {
+	if (this->count != other->count) {
+		return false;
+	}
+	if (this->hashed && other->hashed && this->hash != other->hash) {
+		return false;
+	}
+	return memcmp(this->elements, other->elements, this->count * sizeof(int)) == 0;
+}
+
+/**
+ * Return a hash code for the given SortedIntSet. Equal sets have the same
+ * hash code. The hash is remembered until the set changes.
+ */
+unsigned SortedIntSet_hash(SortedIntSet this) {
+	if (!this->hashed) {
+		// FNV-1a over the sorted elements, each mixed first so that the
+		// low bits of the hash depend on all the bits of the elements
+		unsigned hash = 2166136261u;
+		for (int i=0; i < this->count; i++) {
+			unsigned x = (unsigned)this->elements[i] * 0x9e3779b1u;
+			x ^= x >> 16;
+			hash = (hash ^ x) * 16777619u;
+		}
+		this->hash = hash;
+		this->hashed = true;
+	}
+	return this->hash;
+}
+
+/**
+ * Call the given function on each element of given SortedIntSet, in
+ * increasing order, passing the element (int) to the function.
+ */
+void SortedIntSet_iterate(const SortedIntSet this, void (*func)(int)) {
+	for (int i=0; i < this->count; i++) {
+		func(this->elements[i]);
+	}
+}
+
+struct SortedIntSetIterator {
+	SortedIntSet set;
+	int index;
+};
+
+/**
+ * Return a SortedIntSetIterator for the given SortedIntSet.
+ * Don't forget to free() this when you're done iterating.
+ */
+SortedIntSetIterator SortedIntSet_iterator(const SortedIntSet this) {
+	SortedIntSetIterator iterator = (SortedIntSetIterator)malloc(sizeof(struct SortedIntSetIterator));
+	iterator->set = this;
+	iterator->index = 0;
+	return iterator;
+}
+
+/**
+ * Return true if the next call to SortedIntSetIterator_next on the given
+ * SortedIntSetIterator will not fail.
+ */
+bool SortedIntSetIterator_hasNext(const SortedIntSetIterator this) {
+	return this->index < this->set->count;
+}
+
+/**
+ * Return the next element (int) in the SortedIntSet underlying the
+ * given SortedIntSetIterator, or -1 if there is no such element.
+ */
+int SortedIntSetIterator_next(SortedIntSetIterator this) {
+	if (this->index < this->set->count) {
+		return this->set->elements[this->index++];
+	} else {
+		return -1;
+	}
+}
+
+/**
+ * Print the given SortedIntSet to stdout.
+ */
+void SortedIntSet_print(SortedIntSet this) {
+	printf("{");
+	for (int i=0; i < this->count; i++) {
+		if (i > 0) {
+			printf(",");
+		}
+		printf("%d", this->elements[i]);
+	}
+	printf("}");
+}
+
+/**
+ * Return the string representation of the given SortedIntSet.
+ * Don't forget to free() this string.
+ */
+char* SortedIntSet_toString(SortedIntSet this) {
+	// Room for a comma and the digits and sign of every element
+	char *result = (char*)malloc(this->count * 13 + 1);
+	char *p = result;
+	*p = '\0';
+	for (int i=0; i < this->count; i++) {
+		p += sprintf(p, i > 0 ? ",%d" : "%d", this->elements[i]);
+	}
+	return result;
+}
+
+#ifdef MAIN
+
+static void callback(int element) {
+	printf("callback: %d\n", element);
+}
+
+int main(int argc, char* argv[]) {
+	printf("creating set with size 2...\n");
+	SortedIntSet set1 = new_SortedIntSet(2);
+	printf("testing insert out of order...\n");
+	SortedIntSet_insert(set1, 5);
+	SortedIntSet_insert(set1, 1);
+	SortedIntSet_insert(set1, 3);
+	SortedIntSet_print(set1);
+	printf("\n");
+	printf("testing insert existing elements...\n");
+	SortedIntSet_insert(set1, 5);
+	SortedIntSet_insert(set1, 1);
+	SortedIntSet_print(set1);
+	printf("\n");
+	printf("testing lookup...\n");
+	printf("lookup 1: %d\n", SortedIntSet_lookup(set1, 1));
+	printf("lookup 2: %d\n", SortedIntSet_lookup(set1, 2));
+	printf("lookup 5: %d\n", SortedIntSet_lookup(set1, 5));
+	printf("lookup 6: %d\n", SortedIntSet_lookup(set1, 6));
+	printf("testing iterate...\n");
+	SortedIntSet_iterate(set1, callback);
+	printf("testing iterator...\n");
+	SortedIntSetIterator iterator = SortedIntSet_iterator(set1);
+	while (SortedIntSetIterator_hasNext(iterator)) {
+		printf("%d ", SortedIntSetIterator_next(iterator));
+	}
+	printf("\n");
+	free(iterator);
+	printf("testing union...\n");
+	SortedIntSet set2 = new_SortedIntSet(4);
+	SortedIntSet_insert(set2, 0);
+	SortedIntSet_insert(set2, 3);
+	SortedIntSet_insert(set2, 4);
+	SortedIntSet_insert(set2, 9);
+	SortedIntSet_print(set2);
+	printf(" + ");
+	SortedIntSet_print(set1);
+	SortedIntSet_union(set2, set1);
+	printf(" = ");
+	SortedIntSet_print(set2);
+	printf("\n");
+	printf("testing union of later elements...\n");
+	SortedIntSet set3 = new_SortedIntSet(1);
+	SortedIntSet_insert(set3, 20);
+	SortedIntSet_insert(set3, 10);
+	SortedIntSet_union(set2, set3);
+	SortedIntSet_print(set2);
+	printf("\n");
+	printf("testing equals...\n");
+	SortedIntSet set4 = new_SortedIntSet(0);
+	for (int i=20; i >= 0; i--) {
+		if (SortedIntSet_lookup(set2, i)) {
+			SortedIntSet_insert(set4, i);
+		}
+	}
+	printf("set2 equals set4? %d\n", SortedIntSet_equals(set2, set4));
+	printf("hashes equal? %d\n", SortedIntSet_hash(set2) == SortedIntSet_hash(set4));
+	SortedIntSet_insert(set4, 7);
+	printf("set2 equals set4 after insert? %d\n", SortedIntSet_equals(set2, set4));
+	printf("count: %d\n", SortedIntSet_count(set4));
+	printf("testing toString...\n");
+	char *s = SortedIntSet_toString(set4);
+	printf("s=\"%s\"\n", s);
+	free(s);
+	printf("freeing sets\n");
+	SortedIntSet_free(set1);
+	SortedIntSet_free(set2);
+	SortedIntSet_free(set3);
+	SortedIntSet_free(set4);
+}
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * File: SortedIntSet.h
+ *
+ * A SortedIntSet represents a set of ints as a sorted array. Adding a
+ * single element costs a binary search and a shift, but union is a linear
+ * merge, two sets are equal exactly when their arrays are, and the array
+ * gives every set one canonical hash. That suits sets (like the subsets of
+ * the subset construction) that are compared and hashed more often than
+ * they are changed.
+ */
+
+#ifndef _SortedIntSet_h
+#define _SortedIntSet_h
+
+#include <stdbool.h>
+#include "Arena.h"
+
+typedef struct SortedIntSet* SortedIntSet;
+
+/**
+ * Allocate, initialize and return a new (empty) SortedIntSet with room
+ * for size elements before it needs to grow.
+ */
+extern SortedIntSet new_SortedIntSet(int size);
+
+/**
+ * Allocate, initialize and return a new (empty) SortedIntSet like
+ * new_SortedIntSet(), whose memory comes from the given Arena.
+ */
+extern SortedIntSet new_SortedIntSet_in(Arena arena, int size);
+
+/**
+ * Free the memory used for the given SortedIntSet.
+ */
+extern void SortedIntSet_free(SortedIntSet this);
+
+/**
+ * Return true if the given SortedIntSet is empty.
+ */
+extern bool SortedIntSet_isEmpty(const SortedIntSet this);
+
+/**
+ * Return the number of elements in the given SortedIntSet.
+ */
+extern int SortedIntSet_count(const SortedIntSet this);
+
+/**
+ * Return the number of bytes of memory used by the given SortedIntSet.
+ */
+extern size_t SortedIntSet_bytes(const SortedIntSet this);
+
+/**
+ * Add given element (int) to the given SortedIntSet (if it's not already there).
+ */
+extern void SortedIntSet_insert(SortedIntSet this, int element);
+
+/**
+ * Return true if the given SortedIntSet contains the given int value.
+ */
+extern bool SortedIntSet_lookup(const SortedIntSet this, int element);
+
+/**
+ * Add the contents of the second SortedIntSet to the first SortedIntSet
+ * (adding those elements that aren't already in set1).
+ */
+extern void SortedIntSet_union(SortedIntSet this, const SortedIntSet other);
+
+/**
+ * Return true if the two given SortedIntSets contain exactly the same
+ * members, otherwise false.
+ */
+extern bool SortedIntSet_equals(SortedIntSet this, SortedIntSet other);
+
+/**
+ * Return a hash code for the given SortedIntSet. Equal sets have the same
+ * hash code. The hash is remembered until the set changes.
+ */
+extern unsigned SortedIntSet_hash(SortedIntSet this);
+
+/**
+ * Call the given function on each element of given SortedIntSet, in
+ * increasing order, passing the int value to the function.
+ */
+extern void SortedIntSet_iterate(const SortedIntSet this, void (*func)(int));
+
+typedef struct SortedIntSetIterator *SortedIntSetIterator;
+
+/**
+ * Return a SortedIntSetIterator for the given SortedIntSet.
+ * Don't forget to free() this when you're done iterating.
+ */
+extern SortedIntSetIterator SortedIntSet_iterator(const SortedIntSet set);
+
+/**
+ * Return true if the given SortedIntSetIterator will return another element
+ * if SortedIntSetIterator_next() is called.
+ */
+extern bool SortedIntSetIterator_hasNext(const SortedIntSetIterator this);
+
+/**
+ * Return the next int from the given SortedIntSetIterator and increment it
+ * to point to the next element.
+ */
+extern int SortedIntSetIterator_next(SortedIntSetIterator this);
+
+/**
+ * Print the given SortedIntSet to stdout.
+ */
+extern void SortedIntSet_print(SortedIntSet this);
+
+/**
+ * Return the string representation of the given SortedIntSet.
+ * Don't forget to free() this string.
+ */
+extern char *SortedIntSet_toString(SortedIntSet this);
+
+#endif
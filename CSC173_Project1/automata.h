@@ -0,0 +1,60 @@
+/*
+ * File: automata.h
+ *
+ * The example automata for the project, shared by main.c and dfagrep.c.
+ */
+
+#ifndef _automata_h
+#define _automata_h
+
+#include "dfa.h"
+#include "nfa.h"
+
+/**
+ * DFA that recognizes exactly "csc173".
+ */
+extern DFA initialcsc173();
+
+/**
+ * DFA that recognizes strings starting with "cat".
+ */
+extern DFA initialcat();
+
+/**
+ * DFA that recognizes binary strings with an even number of 0s.
+ */
+extern DFA initialbinary();
+
+/**
+ * DFA that recognizes binary strings with an even number of 0s and an
+ * even number of 1s.
+ */
+extern DFA initialeven01();
+
+/**
+ * DFA that recognizes binary strings containing "01".
+ */
+extern DFA initialcontain01();
+
+/**
+ * NFA that recognizes strings ending in "code".
+ */
+extern NFA initialendcode();
+
+/**
+ * NFA that recognizes strings containing "code".
+ */
+extern NFA initialcontaincode();
+
+/**
+ * NFA that recognizes strings ending in a second occurrence of one of the
+ * letters of "washington" (a third for 'n').
+ */
+extern NFA initialWashington();
+
+/**
+ * NFA that recognizes strings containing "ro", then 's', then 'e'.
+ */
+extern NFA initialbari();
+
+#endif
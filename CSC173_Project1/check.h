@@ -0,0 +1,24 @@
+/*
+ * File: check.h
+ *
+ * The little harness shared by the check programs (the modules built
+ * with -DMAIN): each check prints what it tested and "ok" or "FAILED",
+ * and main returns failures>0 so make sees a failed check.
+ */
+
+#ifndef _check_h
+#define _check_h
+
+#include <stdbool.h>
+#include <stdio.h>
+
+static int failures=0;
+
+static void check(bool ok, const char *what)
+{
+    printf("%s: %s\n", what, ok?"ok":"FAILED");
+    if(!ok)
+        failures++;
+}
+
+#endif
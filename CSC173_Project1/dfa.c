@@ -1,237 +1,1730 @@
-#include "dfa.h"
-#include <stdlib.h>
-#include <stdio.h>
-#include <string.h>
-#include "nfa.h"
-#include "IntHashSet.h"
-#include "LinkedList.h"
-#include <math.h>
-DFA new_DFA(int nstates){
-    DFA dfa= (DFA)malloc(sizeof(struct DFA));
-    dfa->TotalStates=nstates;
-    dfa->Accept=(int *)malloc(sizeof(int)*nstates);
-    dfa->AcceptIndex=0;
-    for(int i=0;i<dfa->TotalStates;i++)
-    {
-        dfa->TransitionTable[i]=malloc(sizeof(int)*128);
-    }
-    for(int i=0;i<dfa->TotalStates;i++)
-    {
-        for(int j=0;j<128;j++)
-        {
-            dfa->TransitionTable[i][j]=-1;
-        }
-    }
-    return dfa;
-}
-void DFA_free(DFA dfa)
-{
-    if(dfa==NULL)
-        return;
-    for(int i=0;i<dfa->TotalStates;i++)
-    {
-        int* rowTable=dfa->TransitionTable[i];
-        free(rowTable);
-    }
-    free(dfa->TransitionTable);
-    free(dfa->Accept);
-    free(dfa);
-    return;
-}
-int DFA_get_size(DFA dfa)
-{
-    return dfa->TotalStates;
-}
-int DFA_get_transition(DFA dfa, int src, char sym)
-{
-     if(src>dfa->TotalStates||src<0)
-     {
-         printf("%s\n","input error");
-         return -1;
-     }
-    int temp=(int)sym;
-    return dfa->TransitionTable[src][temp];
-}
-void DFA_set_transition(DFA dfa, int src, char sym, int dst)
-{
-    if(src>dfa->TotalStates||src<0||dst>dfa->TotalStates||dst<0)
-    {
-        printf("%s\n","input error");
-        return;
-    }
-    int temp=(int)sym;
-    dfa->TransitionTable[src][temp]=dst;
-    return;
-}
-void DFA_set_transition_str(DFA dfa, int src, char *str, int dst)
-{
-    if(src>dfa->TotalStates||src<0||dst>dfa->TotalStates||dst<0)
-    {
-        printf("%s\n","input error");
-        return;
-    }
-    int length=(int) strlen(str);
-    for(int i=0;i<length;i++)
-    {
-        int temp=(int)str[i];
-        dfa->TransitionTable[src][temp]=dst;
-    }
-}
-void DFA_set_transition_all(DFA dfa, int src, int dst)
-{
-    if(src>dfa->TotalStates||src<0||dst>dfa->TotalStates||dst<0)
-    {
-        printf("%s\n","input error");
-        return;
-    }
-    for(int i=0;i<128;i++)
-    {
-        dfa->TransitionTable[src][i]=dst;
-    }
-}
-void DFA_set_accepting(DFA dfa, int state, bool value)
-{
-    if(value==0)
-        return;
-    if(state<0||state>dfa->TotalStates)
-        return;
-    dfa->Accept[dfa->AcceptIndex]=state;
-    dfa->AcceptIndex++;
-}
-bool DFA_get_accepting(DFA dfa, int state)
-{
-    for(int i=0;i<dfa->AcceptIndex;i++)
-    {
-        if(dfa->Accept[i]==state)
-            return 1;
-    }
-    return 0;
-}
-bool DFA_execute(DFA dfa, char *input)
-{
-    int temp=DFA_get_transition(dfa, 0, input[0]);
-    int length=(int)strlen(input);
-    for(int i=1;i<length;i++)
-    {
-        temp=DFA_get_transition(dfa, temp, input[i]);
-        if(temp==-1)
-            return false;
-    }
-    return DFA_get_accepting(dfa, temp);
-}
-void DFA_print(DFA dfa)
-{
-    printf("DFA printing\n It has %d states\n with following acctping states:",dfa->TotalStates);
-    for (int i = 0; i < dfa->TotalStates; i++)
-    {
-        if(dfa->TransitionTable[i])
-            printf("%d ",i );
-    }
-    printf("\n");
-    printf("Print transition\n");
-    printf("State 1 ---input---> State 2");
-    for (int i = 0; i < DFA_get_size(dfa); i++)
-    {
-        for (int j = 0; j < 128; j++)
-        {
-            printf("State %d ---    %c---> State %d",i,j, dfa->TransitionTable[i][j] );
-            printf("\n");
-        }
-    }
-}
-bool ifContains(LinkedList list,IntHashSet set){//find if the list contain the set and return boolean
-    LinkedListIterator iterator = LinkedList_iterator(list);
-    while (LinkedListIterator_hasNext(iterator)) {
-        IntHashSet temp = LinkedListIterator_next(iterator);
-        if(IntHashSet_equals(temp,set)){
-            free(iterator);
-            return 1;
-        }
-    }
-    free(iterator);
-    return 0;
-}
-int findindex(LinkedList list, IntHashSet set){//find the set in the list and return the count number
-    int count=0;
-    LinkedListIterator iterator = LinkedList_iterator(list);
-    while (LinkedListIterator_hasNext(iterator)) {
-        IntHashSet temp = LinkedListIterator_next(iterator);
-        if(IntHashSet_equals(temp,set)==true){
-            free(iterator);
-            return count;
-        }
-        count++;
-    }
-    free(iterator);
-    return -1;
-}
-
-DFA Convert(NFA nfa)
-{
-    DFA this=(DFA)malloc(sizeof(struct DFA));
-    this->TotalStates=(int)pow(2,nfa->TotalStates);
-    this->Accept=(int *)malloc(this->TotalStates*sizeof(int));
-    this->AcceptIndex=0;
-    for(int i=0;i<this->TotalStates;i++){
-        this->TransitionTable[i]=malloc(128*sizeof(int));
-    }
-    for(int i=0;i<this->TotalStates;i++){
-        for(int x=0;x<128;x++){
-            this->TransitionTable[i][x]=-1;
-        }
-    }
-    IntHashSet temp=new_IntHashSet(nfa->TotalStates);
-    IntHashSet result=new_IntHashSet(nfa->TotalStates);
-    IntHashSet start=new_IntHashSet(nfa->TotalStates);
-    
-    LinkedList Transfer=new_LinkedList();
-    int count=0;
-    IntHashSet_insert(start,0);
-    LinkedList_add_at_end(Transfer,start);
-    
-    LinkedListIterator iterator1 = LinkedList_Reverse_iterator(Transfer);
-    
-    while (LinkedListIterator_hasNext(iterator1)){
-        temp=LinkedListIterator_next(iterator1);
-        IntHashSetIterator iterator2 = IntHashSet_iterator(temp);
-        IntHashSetIterator iterator3 = IntHashSet_iterator(result);
-        for(int i=0;i<128;i++){
-            while (IntHashSetIterator_hasNext(iterator2)) {
-                int element = IntHashSetIterator_next(iterator2);
-                IntHashSet_union(result,nfa->TransitionTable[element][i]);
-            }
-            iterator2 = IntHashSet_iterator(temp);
-            if(IntHashSet_isEmpty(result)==true){
-                
-                continue;
-            }
-            if(ifContains(Transfer,result)==false){
-                LinkedList_add_at_end(Transfer,result);
-                iterator1 = LinkedList_Reverse_iterator(Transfer);
-            }
-            iterator3 = IntHashSet_iterator(result);
-            while(IntHashSetIterator_hasNext(iterator3)){
-                int element = IntHashSetIterator_next(iterator3);
-                for(int i=0;i<nfa->AcceptIndex;i++){
-                    if(element==nfa->Accept[i]){
-                        this->Accept[this->AcceptIndex]=findindex(Transfer,result);
-                        this->AcceptIndex++;
-                        break;
-                    }
-                }
-            }
-            this->TransitionTable[count][i]=findindex(Transfer,result);
-            result=new_IntHashSet(nfa->TotalStates);
-        }
-        free(iterator3);
-        free(iterator2);
-        count++;
-    }
-    free(iterator1);
-    LinkedList_free(Transfer,false);
-    IntHashSet_free(temp);
-    IntHashSet_free(result);
-    return this;
-}
-
-
+#include "dfa.h"
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "nfa.h"
+#include "Set.h"
+#include "LinkedList.h"
+#include "SetTable.h"
+#include <pthread.h>
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
+/*
+ * For a DFA with at most 16 states (counting the dead state, which may be
+ * left out if nothing reaches it) keep each symbol class's transitions as
+ * a 16-byte vector mapping state to next state, so they can be applied
+ * and composed with one byte shuffle. Otherwise Shuffle is NULL.
+ */
+static void DFA_build_shuffle(DFA dfa)
+{
+    Arena_release(dfa->arena, dfa->Shuffle);
+    dfa->Shuffle=NULL;
+    int n=dfa->TotalStates;
+    int k=dfa->NumClasses;
+    if(n>16)
+        return;
+    if(n==16)
+    {
+        for(int i=0;i<n*k;i++)
+        {
+            if(dfa->TransitionTable[i]==n)
+                return;
+        }
+    }
+    dfa->Shuffle=(unsigned char *)Arena_malloc(dfa->arena, 16*(size_t)k);
+    for(int c=0;c<k;c++)
+    {
+        for(int s=0;s<16;s++)
+        {
+            int dst=s<=n?dfa->TransitionTable[s*k+c]:n;
+            dfa->Shuffle[c*16+s]=(unsigned char)(dst<16?dst:0);
+        }
+    }
+}
+DFA new_DFA(int nstates){
+    return new_DFA_in(NULL, nstates);
+}
+DFA new_DFA_in(Arena arena, int nstates){
+    DFA dfa= (DFA)Arena_malloc(arena, sizeof(struct DFA));
+    dfa->arena=arena;
+    dfa->TotalStates=nstates;
+    dfa->Accepting=(bool *)Arena_calloc(arena, nstates+1,sizeof(bool));
+    dfa->NumClasses=1;//every byte starts out in one class with no transitions
+    memset(dfa->ByteClass,0,sizeof(dfa->ByteClass));
+    //row nstates is the dead state: it loops to itself and never accepts
+    dfa->TransitionTable=(int *)Arena_malloc(arena, sizeof(int)*(nstates+1));
+    for(int i=0;i<=nstates;i++)
+    {
+        dfa->TransitionTable[i]=nstates;
+    }
+    dfa->Shuffle=NULL;
+    DFA_build_shuffle(dfa);
+    return dfa;
+}
+void DFA_free(DFA dfa)
+{
+    if(dfa==NULL)
+        return;
+    Arena_release(dfa->arena, dfa->TransitionTable);
+    Arena_release(dfa->arena, dfa->Shuffle);
+    Arena_release(dfa->arena, dfa->Accepting);
+    Arena_release(dfa->arena, dfa);
+    return;
+}
+int DFA_get_size(DFA dfa)
+{
+    return dfa->TotalStates;
+}
+int DFA_get_transition(DFA dfa, int src, char sym)
+{
+     if(src>=dfa->TotalStates||src<0)
+     {
+         printf("%s\n","input error");
+         return -1;
+     }
+    int temp=dfa->ByteClass[(unsigned char)sym];
+    int dst=dfa->TransitionTable[src*dfa->NumClasses+temp];
+    return dst==dfa->TotalStates?-1:dst;
+}
+/*
+ * Set the transition from src to dst on every byte b with symbols[b] true.
+ * Any symbol class that is only partly covered, and whose transition from
+ * src differs from dst, is split in two so the covered bytes get their own
+ * column. Classes therefore only ever get as fine as the transitions need.
+ */
+static void DFA_set_symbols(DFA dfa, int src, const bool *symbols, int dst)
+{
+    int k=dfa->NumClasses;
+    int inside[256]={0};
+    int total[256]={0};
+    int split[256];
+    for(int b=0;b<256;b++)
+    {
+        total[dfa->ByteClass[b]]++;
+        if(symbols[b])
+            inside[dfa->ByteClass[b]]++;
+    }
+    int newk=k;
+    for(int c=0;c<k;c++)
+    {
+        split[c]=-1;
+        if(inside[c]>0&&inside[c]<total[c]&&dfa->TransitionTable[src*k+c]!=dst)
+            split[c]=newk++;
+    }
+    if(newk>k)
+    {
+        //widen every row in place, from the last one back so that no row
+        //is overwritten before it has moved; a split-off column starts as
+        //a copy of its parent. In an Arena the table only grows in place
+        //if it was the latest allocation, and otherwise the old one is
+        //left there until the Arena is freed
+        int rows=dfa->TotalStates+1;
+        int *table=(int *)Arena_realloc(dfa->arena, dfa->TransitionTable, sizeof(int)*(size_t)rows*k, sizeof(int)*(size_t)rows*newk);
+        for(int s=rows-1;s>=0;s--)
+        {
+            memmove(table+s*newk,table+s*k,sizeof(int)*k);
+            for(int c=0;c<k;c++)
+            {
+                if(split[c]>=0)
+                    table[s*newk+split[c]]=table[s*newk+c];
+            }
+        }
+        for(int b=0;b<256;b++)
+        {
+            if(symbols[b]&&split[dfa->ByteClass[b]]>=0)
+                dfa->ByteClass[b]=(unsigned char)split[dfa->ByteClass[b]];
+        }
+        dfa->TransitionTable=table;
+        dfa->NumClasses=newk;
+    }
+    for(int b=0;b<256;b++)
+    {
+        if(symbols[b])
+            dfa->TransitionTable[src*newk+dfa->ByteClass[b]]=dst;
+    }
+    if(dfa->TotalStates<=16)
+        DFA_build_shuffle(dfa);
+}
+void DFA_set_transition(DFA dfa, int src, char sym, int dst)
+{
+    if(src>=dfa->TotalStates||src<0||dst>=dfa->TotalStates||dst<0||(unsigned char)sym>=DFA_SYMBOLS)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    bool symbols[256]={false};
+    symbols[(unsigned char)sym]=true;
+    DFA_set_symbols(dfa, src, symbols, dst);
+    return;
+}
+void DFA_set_transition_str(DFA dfa, int src, char *str, int dst)
+{
+    if(src>=dfa->TotalStates||src<0||dst>=dfa->TotalStates||dst<0)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    bool symbols[256]={false};
+    int length=(int) strlen(str);
+    for(int i=0;i<length;i++)
+    {
+        int temp=(unsigned char)str[i];
+        if(temp<DFA_SYMBOLS)
+            symbols[temp]=true;
+    }
+    DFA_set_symbols(dfa, src, symbols, dst);
+}
+void DFA_set_transition_all(DFA dfa, int src, int dst)
+{
+    if(src>=dfa->TotalStates||src<0||dst>=dfa->TotalStates||dst<0)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    bool symbols[256]={false};
+    for(int i=0;i<DFA_SYMBOLS;i++)
+    {
+        symbols[i]=true;
+    }
+    DFA_set_symbols(dfa, src, symbols, dst);
+}
+void DFA_set_accepting(DFA dfa, int state, bool value)
+{
+    if(state<0||state>=dfa->TotalStates)
+        return;
+    dfa->Accepting[state]=value;
+}
+bool DFA_get_accepting(DFA dfa, int state)
+{
+    if(state<0||state>=dfa->TotalStates)
+        return false;
+    return dfa->Accepting[state];
+}
+#ifdef __SSSE3__
+/*
+ * Apply the Shuffle vectors for len bytes of input to each of the 16
+ * states in current, and return where they end up. The vectors for each
+ * 16 input bytes are composed pairwise into one (independent shuffles,
+ * four deep) and then applied, so the serial dependence is one shuffle
+ * per 16 bytes instead of one load per byte. If stop is true, this
+ * returns as soon as the first state is the dead state.
+ */
+static __m128i DFA_shuffle_states(DFA dfa, __m128i current, const unsigned char *input, size_t len, bool stop)
+{
+    const unsigned char *shuffle=dfa->Shuffle;
+    const unsigned char *classes=dfa->ByteClass;
+    const int dead=dfa->TotalStates;
+    size_t i=0;
+    for(;i+16<=len;i+=16)
+    {
+        __m128i v[16];
+        for(int j=0;j<16;j++)
+        {
+            v[j]=_mm_loadu_si128((const __m128i *)(shuffle+16*classes[input[i+j]]));
+        }
+        for(int width=1;width<16;width*=2)
+        {
+            for(int j=0;j<16;j+=2*width)
+            {
+                v[j]=_mm_shuffle_epi8(v[j+width], v[j]);//v[j] then v[j+width]
+            }
+        }
+        current=_mm_shuffle_epi8(v[0], current);
+        if(stop&&(_mm_cvtsi128_si32(current)&0xff)==dead)
+            return current;
+    }
+    for(;i<len;i++)
+    {
+        current=_mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(shuffle+16*classes[input[i]])), current);
+    }
+    return current;
+}
+#endif
+/*
+ * Run a DFA that has Shuffle vectors: with SSSE3, sixteen bytes at a time
+ * (see DFA_shuffle_states), otherwise one lookup in the vectors per byte.
+ */
+static int DFA_run_shuffle(DFA dfa, int state, const unsigned char *input, size_t len)
+{
+#ifdef __SSSE3__
+    __m128i current=DFA_shuffle_states(dfa, _mm_set1_epi8((char)state), input, len, true);
+    return _mm_cvtsi128_si32(current)&0xff;
+#else
+    const unsigned char *shuffle=dfa->Shuffle;
+    const unsigned char *classes=dfa->ByteClass;
+    const int dead=dfa->TotalStates;
+    for(size_t i=0;i<len;i++)
+    {
+        state=shuffle[16*classes[input[i]]+state];
+        if(state==dead)
+            break;
+    }
+    return state;
+#endif
+}
+/*
+ * Run the table from the given state over len bytes and return the state
+ * reached. The only branch in the loop is the exit on the dead state.
+ */
+static int DFA_run(DFA dfa, int state, const unsigned char *input, size_t len)
+{
+    const int *table=dfa->TransitionTable;
+    const unsigned char *classes=dfa->ByteClass;
+    const int k=dfa->NumClasses;
+    const int dead=dfa->TotalStates;
+    if(dfa->Shuffle!=NULL)
+        return DFA_run_shuffle(dfa, state, input, len);
+    for(size_t i=0;i<len;i++)
+    {
+        state=table[state*k+classes[input[i]]];
+        if(state==dead)
+            break;
+    }
+    return state;
+}
+bool DFA_execute_n(DFA dfa, const char *buf, size_t len)
+{
+    if(dfa==NULL||dfa->TotalStates<=0||(buf==NULL&&len>0))
+        return false;
+    int state=DFA_run(dfa, 0, (const unsigned char *)buf, len);
+    return dfa->Accepting[state];
+}
+bool DFA_execute(DFA dfa, char *input)
+{
+    return DFA_execute_n(dfa, input, strlen(input));
+}
+#define DFA_PARALLEL_MIN_CHUNK 65536
+#define DFA_PARALLEL_BLOCK 256
+/*
+ * One chunk of a parallel run: the chunk's input, and the map it fills in
+ * from each possible start state (including the dead state) to the state
+ * reached at the end of the chunk.
+ */
+struct DFA_chunk {
+    DFA dfa;
+    const unsigned char *input;
+    size_t len;
+    int *map;
+};
+/*
+ * Run a chunk from every start state at once. With SSSE3 and Shuffle
+ * vectors, the runs are the 16 lanes of one vector and each byte costs
+ * the same as in a serial run. Otherwise runs that reach the same state
+ * are merged (checked every DFA_PARALLEL_BLOCK bytes), so in practice
+ * only a few distinct runs survive past the start of the chunk.
+ */
+static void *DFA_chunk_map(void *arg)
+{
+    struct DFA_chunk *chunk=arg;
+    DFA dfa=chunk->dfa;
+    int nstates=dfa->TotalStates+1;
+#ifdef __SSSE3__
+    if(dfa->Shuffle!=NULL)
+    {
+        __m128i start=_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        unsigned char end[16];
+        _mm_storeu_si128((__m128i *)end, DFA_shuffle_states(dfa, start, chunk->input, chunk->len, false));
+        //with 16 states there is no lane for the dead state, which stays put
+        for(int s=0;s<nstates;s++)
+        {
+            chunk->map[s]=s<16?end[s]:s;
+        }
+        return NULL;
+    }
+#endif
+    int *slot=(int *)malloc(sizeof(int)*nstates);  //start state -> run
+    int *run=(int *)malloc(sizeof(int)*nstates);   //run -> current state
+    int *remap=(int *)malloc(sizeof(int)*nstates); //old run -> merged run
+    int *merged=(int *)malloc(sizeof(int)*nstates);//current state -> merged run
+    for(int s=0;s<nstates;s++)
+    {
+        slot[s]=s;
+        run[s]=s;
+        merged[s]=-1;
+    }
+    int nruns=nstates;
+    const int *table=dfa->TransitionTable;
+    const unsigned char *classes=dfa->ByteClass;
+    const int k=dfa->NumClasses;
+    size_t pos=0;
+    while(pos<chunk->len)
+    {
+        size_t end=chunk->len;
+        if(nruns>1&&end-pos>DFA_PARALLEL_BLOCK)
+            end=pos+DFA_PARALLEL_BLOCK;
+        for(size_t i=pos;i<end;i++)
+        {
+            int column=classes[chunk->input[i]];
+            for(int r=0;r<nruns;r++)
+            {
+                run[r]=table[run[r]*k+column];
+            }
+        }
+        pos=end;
+        int m=0;
+        for(int r=0;r<nruns;r++)
+        {
+            int state=run[r];
+            if(merged[state]<0)
+            {
+                merged[state]=m;
+                run[m++]=state;
+            }
+            remap[r]=merged[state];
+        }
+        for(int s=0;s<nstates;s++)
+        {
+            slot[s]=remap[slot[s]];
+        }
+        for(int r=0;r<m;r++)
+        {
+            merged[run[r]]=-1;
+        }
+        nruns=m;
+    }
+    for(int s=0;s<nstates;s++)
+    {
+        chunk->map[s]=run[slot[s]];
+    }
+    free(merged);
+    free(remap);
+    free(run);
+    free(slot);
+    return NULL;
+}
+bool DFA_execute_parallel(DFA dfa, const char *buf, size_t len, int nthreads)
+{
+    if(nthreads>(int)(len/DFA_PARALLEL_MIN_CHUNK))
+        nthreads=(int)(len/DFA_PARALLEL_MIN_CHUNK);
+    if(nthreads<=1||dfa==NULL||dfa->TotalStates<=0)
+        return DFA_execute_n(dfa, buf, len);
+    const unsigned char *input=(const unsigned char *)buf;
+    int nstates=dfa->TotalStates+1;
+    struct DFA_chunk *chunks=(struct DFA_chunk *)malloc(sizeof(struct DFA_chunk)*nthreads);
+    pthread_t *threads=(pthread_t *)malloc(sizeof(pthread_t)*nthreads);
+    bool *started=(bool *)malloc(sizeof(bool)*nthreads);
+    int *maps=(int *)malloc(sizeof(int)*(size_t)nstates*nthreads);
+    size_t size=len/nthreads;
+    for(int t=1;t<nthreads;t++)
+    {
+        chunks[t].dfa=dfa;
+        chunks[t].input=input+size*t;
+        chunks[t].len=t==nthreads-1?len-size*t:size;
+        chunks[t].map=maps+(size_t)nstates*t;
+        //if there's no thread for a chunk, map it here instead
+        started[t]=pthread_create(&threads[t], NULL, DFA_chunk_map, &chunks[t])==0;
+        if(!started[t])
+            DFA_chunk_map(&chunks[t]);
+    }
+    //the first chunk only ever starts from state 0
+    int state=DFA_run(dfa, 0, input, size);
+    for(int t=1;t<nthreads;t++)
+    {
+        if(started[t])
+            pthread_join(threads[t], NULL);
+        state=chunks[t].map[state];
+    }
+    bool accepted=dfa->Accepting[state];
+    free(maps);
+    free(started);
+    free(threads);
+    free(chunks);
+    return accepted;
+}
+/**
+ * A DFA_stream is the state of one DFA run over input that arrives in
+ * pieces.
+ */
+struct DFA_stream {
+    DFA dfa;
+    int state;
+};
+DFA_stream DFA_stream_begin(DFA dfa)
+{
+    DFA_stream stream=(DFA_stream)malloc(sizeof(struct DFA_stream));
+    stream->dfa=dfa;
+    stream->state=(dfa!=NULL&&dfa->TotalStates>0)?0:-1;
+    return stream;
+}
+void DFA_stream_feed(DFA_stream stream, const char *chunk, size_t len)
+{
+    if(stream->state<0||stream->state==stream->dfa->TotalStates||(chunk==NULL&&len>0))
+        return;//no automaton, or already dead: the rest of the input can't matter
+    stream->state=DFA_run(stream->dfa, stream->state, (const unsigned char *)chunk, len);
+}
+bool DFA_stream_finish(DFA_stream stream)
+{
+    bool accepted=stream->state>=0&&stream->dfa->Accepting[stream->state];
+    free(stream);
+    return accepted;
+}
+#define DFA_BATCH_LANES 8
+#define DFA_BATCH_MIN_LENGTH 16
+#define DFA_BATCH_BLOCK 64
+/*
+ * Start the next string that needs running on the given lane. Strings
+ * shorter than DFA_BATCH_MIN_LENGTH are run on the spot instead, since
+ * there is too little of them to overlap with other lanes to pay for
+ * taking a lane. Returns false if there are none left.
+ */
+static bool DFA_batch_refill(DFA dfa, const char *const *strings, const size_t *lengths, size_t n, size_t *next, unsigned char *results,
+                             const unsigned char **ptr, size_t *left, size_t *id, int *state)
+{
+    while(*next<n)
+    {
+        size_t i=(*next)++;
+        size_t len=lengths!=NULL?lengths[i]:strlen(strings[i]);
+        if(len<DFA_BATCH_MIN_LENGTH)
+        {
+            if(dfa->Accepting[DFA_run(dfa, 0, (const unsigned char *)strings[i], len)])
+                results[i/8]|=(unsigned char)(1<<(i%8));
+            continue;
+        }
+        *ptr=(const unsigned char *)strings[i];
+        *left=len;
+        *id=i;
+        *state=0;
+        return true;
+    }
+    return false;
+}
+void DFA_execute_batch(DFA dfa, const char *const *strings, const size_t *lengths, size_t n, unsigned char *results)
+{
+    memset(results, 0, (n+7)/8);
+    if(dfa==NULL||dfa->TotalStates<=0)
+        return;
+    const int *table=dfa->TransitionTable;
+    const unsigned char *classes=dfa->ByteClass;
+    const int k=dfa->NumClasses;
+    const int dead=dfa->TotalStates;
+    const unsigned char *ptr[DFA_BATCH_LANES];
+    size_t left[DFA_BATCH_LANES];
+    size_t id[DFA_BATCH_LANES];
+    int state[DFA_BATCH_LANES];
+    size_t next=0;
+    int active=0;
+    while(active<DFA_BATCH_LANES&&DFA_batch_refill(dfa, strings, lengths, n, &next, results, &ptr[active], &left[active], &id[active], &state[active]))
+        active++;
+    //every lane steps together for as many bytes as the nearest end of a
+    //string; that lane then takes the next string straight away, so no
+    //lane waits on a longer one
+    while(active==DFA_BATCH_LANES)
+    {
+        size_t m=DFA_BATCH_BLOCK;
+        for(int l=0;l<DFA_BATCH_LANES;l++)
+            if(left[l]<m)
+                m=left[l];
+        //the lanes are independent, so their loads overlap instead of
+        //queueing; the dead state loops to itself, so no exit is needed.
+        //An AVX2 gather of all eight lanes was tried here and was about
+        //1.5 times slower than these scalar loads (see dfabench)
+        for(size_t j=0;j<m;j++)
+            for(int l=0;l<DFA_BATCH_LANES;l++)
+                state[l]=table[state[l]*k+classes[ptr[l][j]]];
+        for(int l=0;l<active;)
+        {
+            ptr[l]+=m;
+            left[l]-=m;
+            if(left[l]>0&&state[l]!=dead)
+            {
+                l++;
+                continue;
+            }
+            if(left[l]==0&&dfa->Accepting[state[l]])
+                results[id[l]/8]|=(unsigned char)(1<<(id[l]%8));
+            if(DFA_batch_refill(dfa, strings, lengths, n, &next, results, &ptr[l], &left[l], &id[l], &state[l]))
+            {
+                l++;
+                continue;
+            }
+            //nothing left to start: the last lane moves into this one
+            active--;
+            ptr[l]=ptr[active];
+            left[l]=left[active];
+            id[l]=id[active];
+            state[l]=state[active];
+        }
+    }
+    //too few strings left to fill the lanes: finish them one at a time
+    for(int l=0;l<active;l++)
+        if(dfa->Accepting[DFA_run(dfa, state[l], ptr[l], left[l])])
+            results[id[l]/8]|=(unsigned char)(1<<(id[l]%8));
+}
+void DFA_print(DFA dfa)
+{
+    printf("DFA printing\n It has %d states\n with following acctping states:",dfa->TotalStates);
+    for (int i = 0; i < dfa->TotalStates; i++)
+    {
+        if(DFA_get_accepting(dfa, i))
+            printf("%d ",i );
+    }
+    printf("\n");
+    printf("Print transition\n");
+    printf("State 1 ---input---> State 2");
+    for (int i = 0; i < DFA_get_size(dfa); i++)
+    {
+        for (int j = 0; j < DFA_SYMBOLS; j++)
+        {
+            printf("State %d ---    %c---> State %d",i,j, DFA_get_transition(dfa, i, (char)j) );
+            printf("\n");
+        }
+    }
+}
+/*
+ * Allocate a DFA in the given Arena with the given number of states and no
+ * transitions whose symbols are grouped into the given classes.
+ */
+static DFA new_DFA_classes(Arena arena, int nstates, int k, const unsigned char *byteclass)
+{
+    DFA dfa=new_DFA_in(arena, nstates);
+    Arena_release(arena, dfa->TransitionTable);
+    dfa->TransitionTable=(int *)Arena_malloc(arena, sizeof(int)*(size_t)(nstates+1)*k);
+    for(size_t i=0;i<(size_t)(nstates+1)*k;i++)
+    {
+        dfa->TransitionTable[i]=nstates;
+    }
+    dfa->NumClasses=k;
+    memcpy(dfa->ByteClass, byteclass, sizeof(dfa->ByteClass));
+    return dfa;
+}
+/*
+ * Merge symbol classes whose columns have become identical, e.g. after
+ * minimization has merged the states that told them apart.
+ */
+static void DFA_merge_classes(DFA dfa)
+{
+    int k=dfa->NumClasses;
+    int rows=dfa->TotalStates+1;
+    int *table=dfa->TransitionTable;
+    int newclass[256];
+    int newk=0;
+    int keep[256];
+    for(int c=0;c<k;c++)
+    {
+        newclass[c]=-1;
+        for(int d=0;d<newk&&newclass[c]<0;d++)
+        {
+            int s=0;
+            while(s<rows&&table[s*k+c]==table[s*k+keep[d]])
+                s++;
+            if(s==rows)
+                newclass[c]=d;
+        }
+        if(newclass[c]<0)
+        {
+            keep[newk]=c;
+            newclass[c]=newk++;
+        }
+    }
+    if(newk==k)
+        return;
+    int *merged=(int *)Arena_malloc(dfa->arena, sizeof(int)*(size_t)rows*newk);
+    for(int s=0;s<rows;s++)
+    {
+        for(int d=0;d<newk;d++)
+        {
+            merged[s*newk+d]=table[s*k+keep[d]];
+        }
+    }
+    for(int b=0;b<256;b++)
+    {
+        dfa->ByteClass[b]=(unsigned char)newclass[dfa->ByteClass[b]];
+    }
+    Arena_release(dfa->arena, dfa->TransitionTable);
+    dfa->TransitionTable=merged;
+    dfa->NumClasses=newk;
+}
+struct DFA_labeled_state {
+    int label;
+    int state;
+};
+static int DFA_compare_labels(const void *a, const void *b)
+{
+    const struct DFA_labeled_state *x=a;
+    const struct DFA_labeled_state *y=b;
+    if(x->label!=y->label)
+        return x->label<y->label?-1:1;
+    return x->state-y->state;
+}
+/*
+ * Hopcroft's partition refinement. States of the given DFA (including the
+ * dead state, entry TotalStates) with different labels are never merged.
+ * Unreachable states are dropped first, and the states of the result are
+ * numbered in breadth-first order from the start state. If map is not
+ * NULL, map[s] is set to the new number of old state s, or -1 if it was
+ * dropped or merged into the dead state. The result is allocated in the
+ * given Arena.
+ */
+static DFA DFA_minimize_labeled(DFA dfa, const int *label, int *map, Arena arena)
+{
+    const int k=dfa->NumClasses;
+    const int total=dfa->TotalStates;
+    const int *table=dfa->TransitionTable;
+    //number the reachable states from 0, and the dead state after them
+    int *id=(int *)malloc(sizeof(int)*(total+1));
+    int *old=(int *)malloc(sizeof(int)*(total+1));
+    for(int s=0;s<=total;s++)
+    {
+        id[s]=-1;
+    }
+    int n=0;
+    id[0]=n;
+    old[n++]=0;
+    for(int i=0;i<n;i++)
+    {
+        for(int c=0;c<k;c++)
+        {
+            int t=table[old[i]*k+c];
+            if(t!=total&&id[t]<0)
+            {
+                id[t]=n;
+                old[n++]=t;
+            }
+        }
+    }
+    id[total]=n;
+    old[n]=total;
+    const int N=n+1;
+    int *delta=(int *)malloc(sizeof(int)*(size_t)N*k);
+    for(int i=0;i<N;i++)
+    {
+        for(int c=0;c<k;c++)
+        {
+            delta[i*k+c]=id[table[old[i]*k+c]];
+        }
+    }
+    //predecessors of each state on each class, as one packed array
+    int *first_pred=(int *)calloc((size_t)N*k+1, sizeof(int));
+    int *pred=(int *)malloc(sizeof(int)*(size_t)N*k);
+    for(int i=0;i<N;i++)
+    {
+        for(int c=0;c<k;c++)
+        {
+            first_pred[c*N+delta[i*k+c]+1]++;
+        }
+    }
+    for(int j=0;j<N*k;j++)
+    {
+        first_pred[j+1]+=first_pred[j];
+    }
+    int *fill=(int *)malloc(sizeof(int)*(size_t)N*k);
+    memcpy(fill, first_pred, sizeof(int)*(size_t)N*k);
+    for(int i=0;i<N;i++)
+    {
+        for(int c=0;c<k;c++)
+        {
+            pred[fill[c*N+delta[i*k+c]]++]=i;
+        }
+    }
+    free(fill);
+    //the partition: each block is a contiguous run of elems, with its marked states first
+    int *elems=(int *)malloc(sizeof(int)*N);
+    int *where=(int *)malloc(sizeof(int)*N);
+    int *block=(int *)malloc(sizeof(int)*N);
+    int *begin=(int *)malloc(sizeof(int)*N);
+    int *end=(int *)malloc(sizeof(int)*N);
+    int *marked=(int *)calloc(N, sizeof(int));
+    bool *pending=(bool *)calloc(N, sizeof(bool));
+    int *work=(int *)malloc(sizeof(int)*N);
+    int nwork=0;
+    int nblocks=0;
+    struct DFA_labeled_state *sorted=(struct DFA_labeled_state *)malloc(sizeof(struct DFA_labeled_state)*N);
+    for(int i=0;i<N;i++)
+    {
+        sorted[i].label=label[old[i]];
+        sorted[i].state=i;
+    }
+    qsort(sorted, N, sizeof(struct DFA_labeled_state), DFA_compare_labels);
+    int largest=0;
+    for(int i=0;i<N;i++)
+    {
+        if(i==0||sorted[i].label!=sorted[i-1].label)
+        {
+            begin[nblocks]=i;
+            nblocks++;
+        }
+        elems[i]=sorted[i].state;
+        where[elems[i]]=i;
+        block[elems[i]]=nblocks-1;
+        end[nblocks-1]=i+1;
+    }
+    free(sorted);
+    for(int b=0;b<nblocks;b++)
+    {
+        if(end[b]-begin[b]>end[largest]-begin[largest])
+            largest=b;
+    }
+    for(int b=0;b<nblocks;b++)
+    {
+        if(b!=largest)
+        {
+            work[nwork++]=b;
+            pending[b]=true;
+        }
+    }
+    int *splitter=(int *)malloc(sizeof(int)*N);
+    int *touched=(int *)malloc(sizeof(int)*N);
+    while(nwork>0)
+    {
+        int B=work[--nwork];
+        pending[B]=false;
+        int size=end[B]-begin[B];
+        memcpy(splitter, elems+begin[B], sizeof(int)*size);
+        for(int c=0;c<k;c++)
+        {
+            int ntouched=0;
+            for(int j=0;j<size;j++)
+            {
+                int t=splitter[j];
+                for(int p=first_pred[c*N+t];p<first_pred[c*N+t+1];p++)
+                {
+                    int s=pred[p];
+                    int b=block[s];
+                    int m=begin[b]+marked[b];
+                    if(where[s]<m)
+                        continue;//already marked
+                    elems[where[s]]=elems[m];
+                    where[elems[m]]=where[s];
+                    elems[m]=s;
+                    where[s]=m;
+                    if(marked[b]++==0)
+                        touched[ntouched++]=b;
+                }
+            }
+            for(int j=0;j<ntouched;j++)
+            {
+                int b=touched[j];
+                if(marked[b]==end[b]-begin[b])
+                {
+                    marked[b]=0;
+                    continue;
+                }
+                //split the marked states off into a new block
+                int nb=nblocks++;
+                begin[nb]=begin[b];
+                end[nb]=begin[b]+marked[b];
+                begin[b]=end[nb];
+                marked[b]=0;
+                marked[nb]=0;
+                for(int p=begin[nb];p<end[nb];p++)
+                {
+                    block[elems[p]]=nb;
+                }
+                if(pending[b]||end[nb]-begin[nb]<=end[b]-begin[b])
+                {
+                    work[nwork++]=nb;
+                    pending[nb]=true;
+                }
+                else
+                {
+                    work[nwork++]=b;
+                    pending[b]=true;
+                }
+            }
+        }
+    }
+    free(touched);
+    free(splitter);
+    //number the blocks breadth-first from the start state's block
+    int dead=block[n];
+    int *newid=(int *)malloc(sizeof(int)*nblocks);
+    int *rep=(int *)malloc(sizeof(int)*nblocks);
+    for(int b=0;b<nblocks;b++)
+    {
+        newid[b]=-1;
+        rep[b]=elems[begin[b]];
+    }
+    int m=0;
+    newid[block[0]]=m;
+    work[m++]=block[0];
+    for(int i=0;i<m&&block[0]!=dead;i++)
+    {
+        for(int c=0;c<k;c++)
+        {
+            int t=block[delta[rep[work[i]]*k+c]];
+            if(t!=dead&&newid[t]<0)
+            {
+                newid[t]=m;
+                work[m++]=t;
+            }
+        }
+    }
+    DFA result=new_DFA_classes(arena, m, k, dfa->ByteClass);
+    for(int i=0;i<m&&block[0]!=dead;i++)
+    {
+        int b=work[i];
+        for(int c=0;c<k;c++)
+        {
+            int t=block[delta[rep[b]*k+c]];
+            result->TransitionTable[i*k+c]=t==dead?m:newid[t];
+        }
+        result->Accepting[i]=dfa->Accepting[old[rep[b]]];
+    }
+    if(map!=NULL)
+    {
+        for(int s=0;s<=total;s++)
+        {
+            map[s]=(id[s]<0||block[id[s]]==dead)?-1:newid[block[id[s]]];
+        }
+        if(block[0]==dead)
+            map[0]=0;
+    }
+    DFA_merge_classes(result);
+    DFA_build_shuffle(result);
+    free(rep);
+    free(newid);
+    free(work);
+    free(pending);
+    free(marked);
+    free(end);
+    free(begin);
+    free(block);
+    free(where);
+    free(elems);
+    free(pred);
+    free(first_pred);
+    free(delta);
+    free(old);
+    free(id);
+    return result;
+}
+DFA DFA_minimize(DFA dfa)
+{
+    return DFA_minimize_in(NULL, dfa);
+}
+DFA DFA_minimize_in(Arena arena, DFA dfa)
+{
+    int *label=(int *)malloc(sizeof(int)*(dfa->TotalStates+1));
+    for(int s=0;s<=dfa->TotalStates;s++)
+    {
+        label[s]=dfa->Accepting[s];
+    }
+    DFA result=DFA_minimize_labeled(dfa, label, NULL, arena);
+    free(label);
+    return result;
+}
+/*
+ * Return true if any of the NFA states in the given subset is accepting.
+ */
+static bool Convert_accepting(NFA nfa, Set subset)
+{
+    bool accepting=false;
+    SetIterator iterator=Set_iterator(subset);
+    while(SetIterator_hasNext(iterator)){
+        if(nfa->Accepting[SetIterator_next(iterator)]){
+            accepting=true;
+            break;
+        }
+    }
+    free(iterator);
+    return accepting;
+}
+/*
+ * Return the index in matches of the set of patterns (from pattern[], by
+ * NFA state, each less than npatterns) whose accepting states are in the
+ * given subset, adding the set if it is new.
+ */
+static int Convert_label(NFA nfa, Set subset, const int *pattern, int npatterns, SetTable matches, Arena arena)
+{
+    Set ids=new_Set_in(arena, npatterns);
+    SetIterator iterator=Set_iterator(subset);
+    while(SetIterator_hasNext(iterator)){
+        int s=SetIterator_next(iterator);
+        if(nfa->Accepting[s]&&pattern[s]>=0)
+            Set_insert(ids,pattern[s]);
+    }
+    free(iterator);
+    int label=SetTable_lookup(matches,ids);
+    if(label>=0){
+        Set_free(ids);
+        return label;
+    }
+    return SetTable_add(matches,ids);
+}
+/*
+ * The subset construction, with the DFA and all the working storage
+ * (subsets, table and queue) allocated in the given Arena. If pattern
+ * isn't NULL, *labels is set to an array (in the Arena) giving each DFA
+ * state its Convert_label() in matches.
+ */
+static DFA Convert_subsets(NFA nfa, Arena arena, const int *pattern, int npatterns, SetTable matches, int **labels)
+{
+    NFA_compile(nfa);
+    int k=nfa->NumClasses;
+    //rows are added as subsets are found, -1 for no transition
+    int capacity=16;
+    int *table=(int *)Arena_malloc(arena, sizeof(int)*(size_t)capacity*k);
+    bool *accepting=(bool *)Arena_malloc(arena, sizeof(bool)*capacity);
+    int *label=pattern!=NULL?(int *)Arena_malloc(arena, sizeof(int)*capacity):NULL;
+    SetTable states=new_SetTable_in(arena);//subset -> DFA state, numbered in the order found
+    Worklist pending=new_Worklist_in(arena);//subsets whose rows are still to do, in the order found
+    Set start=new_Set_in(arena, nfa->TotalStates);
+    for(int i=0;i<nfa->NumStart;i++){
+        Set_insert(start,nfa->Start[i]);
+    }
+    SetTable_add(states,start);
+    accepting[0]=Convert_accepting(nfa,start);
+    if(label!=NULL)
+        label[0]=Convert_label(nfa,start,pattern,npatterns,matches,arena);
+    Worklist_push(pending,start);
+    int count=0;
+    while(!Worklist_isEmpty(pending)){
+        Set temp=Worklist_pop(pending);
+        for(int i=0;i<k;i++){
+            Set result=new_Set_in(arena, nfa->TotalStates);
+            SetIterator iterator=Set_iterator(temp);
+            while(SetIterator_hasNext(iterator)){
+                size_t row=(size_t)SetIterator_next(iterator)*k+i;
+                for(int j=nfa->Offsets[row];j<nfa->Offsets[row+1];j++){
+                    Set_insert(result,nfa->Successors[j]);
+                }
+            }
+            free(iterator);
+            if(Set_isEmpty(result)){
+                Set_free(result);
+                table[(size_t)count*k+i]=-1;
+                continue;
+            }
+            int index=SetTable_lookup(states,result);
+            if(index<0){
+                index=SetTable_add(states,result);
+                if(index==capacity){
+                    table=(int *)Arena_realloc(arena, table, sizeof(int)*(size_t)capacity*k, sizeof(int)*(size_t)2*capacity*k);
+                    accepting=(bool *)Arena_realloc(arena, accepting, sizeof(bool)*capacity, sizeof(bool)*2*capacity);
+                    if(label!=NULL)
+                        label=(int *)Arena_realloc(arena, label, sizeof(int)*capacity, sizeof(int)*2*capacity);
+                    capacity*=2;
+                }
+                accepting[index]=Convert_accepting(nfa,result);
+                if(label!=NULL)
+                    label[index]=Convert_label(nfa,result,pattern,npatterns,matches,arena);
+                Worklist_push(pending,result);
+            }else{
+                Set_free(result);
+            }
+            table[(size_t)count*k+i]=index;
+        }
+        count++;
+    }
+    DFA this=new_DFA_classes(arena, count, k, nfa->ByteClass);
+    for(size_t i=0;i<(size_t)count*k;i++){
+        if(table[i]>=0)
+            this->TransitionTable[i]=table[i];
+    }
+    memcpy(this->Accepting, accepting, sizeof(bool)*count);
+    DFA_build_shuffle(this);
+    Arena_release(arena, accepting);
+    Arena_release(arena, table);
+    Worklist_free(pending,false);
+    SetTable_free(states,true);
+    if(labels!=NULL)
+        *labels=label;
+    return this;
+}
+DFA Convert_unminimized(NFA nfa)
+{
+    return Convert_subsets(nfa, NULL, NULL, 0, NULL, NULL);
+}
+DFA Convert(NFA nfa)
+{
+    return Convert_in(NULL, nfa);
+}
+DFA Convert_in(Arena arena, NFA nfa)
+{
+    //everything but the minimized DFA is thrown away together
+    Arena scratch=new_Arena(0);
+    DFA full=Convert_subsets(nfa, scratch, NULL, 0, NULL, NULL);
+    DFA result=DFA_minimize_in(arena, full);
+    Arena_free(scratch);
+    return result;
+}
+/*
+ * The patterns that match in each state of dfa (and none in its dead
+ * state) are Matches[MatchOffsets[s] .. MatchOffsets[s+1]).
+ */
+struct DFA_multi {
+    DFA dfa;          // accepts where any pattern matches
+    int *MatchOffsets;
+    int *Matches;
+};
+static int DFA_compare_ints(const void *a, const void *b)
+{
+    int x=*(const int *)a;
+    int y=*(const int *)b;
+    return x<y?-1:x>y;
+}
+DFA_multi Convert_union(NFA *nfas, int count)
+{
+    int total=1;
+    for(int i=0;i<count;i++)
+    {
+        total+=nfas[i]->TotalStates;
+    }
+    int *pattern=(int *)malloc(sizeof(int)*total);
+    NFA nfa=NFA_union(nfas, count, pattern);
+    Arena scratch=new_Arena(0);
+    //label 0 is the empty set, which the dead state gets too
+    SetTable matches=new_SetTable_in(scratch);
+    SetTable_add(matches, new_Set_in(scratch, count));
+    int *labels;
+    DFA full=Convert_subsets(nfa, scratch, pattern, count, matches, &labels);
+    int n=full->TotalStates;
+    int *label=(int *)malloc(sizeof(int)*(n+1));
+    memcpy(label, labels, sizeof(int)*n);
+    label[n]=0;
+    int *map=(int *)malloc(sizeof(int)*(n+1));
+    DFA_multi multi=(DFA_multi)malloc(sizeof(struct DFA_multi));
+    multi->dfa=DFA_minimize_labeled(full, label, map, NULL);
+
+    //states merged by minimization have the same label
+    int m=multi->dfa->TotalStates;
+    int *stateLabel=(int *)calloc((size_t)m+1, sizeof(int));
+    for(int s=0;s<n;s++)
+    {
+        if(map[s]>=0)
+            stateLabel[map[s]]=label[s];
+    }
+    multi->MatchOffsets=(int *)malloc(sizeof(int)*((size_t)m+2));
+    multi->MatchOffsets[0]=0;
+    for(int s=0;s<=m;s++)
+    {
+        multi->MatchOffsets[s+1]=multi->MatchOffsets[s]+Set_count(SetTable_get(matches, stateLabel[s]));
+    }
+    multi->Matches=(int *)malloc(sizeof(int)*((size_t)multi->MatchOffsets[m+1]+1));
+    for(int s=0;s<=m;s++)
+    {
+        int i=multi->MatchOffsets[s];
+        SetIterator iterator=Set_iterator(SetTable_get(matches, stateLabel[s]));
+        while(SetIterator_hasNext(iterator))
+        {
+            multi->Matches[i++]=SetIterator_next(iterator);
+        }
+        free(iterator);
+        qsort(multi->Matches+multi->MatchOffsets[s], i-multi->MatchOffsets[s], sizeof(int), DFA_compare_ints);
+    }
+    free(stateLabel);
+    free(map);
+    free(label);
+    Arena_free(scratch);
+    NFA_free(nfa);
+    free(pattern);
+    return multi;
+}
+void DFA_multi_free(DFA_multi multi)
+{
+    if(multi==NULL)
+        return;
+    DFA_free(multi->dfa);
+    free(multi->MatchOffsets);
+    free(multi->Matches);
+    free(multi);
+}
+int DFA_multi_execute(DFA_multi multi, const char *buf, size_t len, const int **matched)
+{
+    DFA dfa=multi->dfa;
+    int state=dfa->TotalStates;
+    if(dfa->TotalStates>0&&(buf!=NULL||len==0))
+        state=DFA_run(dfa, 0, (const unsigned char *)buf, len);
+    if(matched!=NULL)
+        *matched=multi->Matches+multi->MatchOffsets[state];
+    return multi->MatchOffsets[state+1]-multi->MatchOffsets[state];
+}
+
+#ifdef MAIN
+
+#include "automata.h"
+#include "check.h"
+
+/*
+ * An NFA for the strings that start with the given word, or that contain
+ * it anywhere if anywhere is true.
+ */
+static NFA word_NFA(char *word, bool anywhere)
+{
+    int len=(int)strlen(word);
+    NFA nfa=new_NFA(len+1);
+    if(anywhere)
+        NFA_add_transition_all(nfa, 0, 0);
+    for(int i=0;i<len;i++)
+        NFA_add_transition(nfa, i, word[i], i+1);
+    NFA_add_transition_all(nfa, len, len);
+    NFA_set_accepting(nfa, len, true);
+    return nfa;
+}
+
+/*
+ * A DFA for the strings containing the given word.
+ */
+static DFA containing(char *word)
+{
+    NFA nfa=word_NFA(word, true);
+    DFA dfa=Convert(nfa);
+    NFA_free(nfa);
+    return dfa;
+}
+
+/*
+ * n random strings of lo to hi characters drawn from alphabet, with their
+ * lengths; free them with free_strings().
+ */
+static char **random_strings(size_t n, int lo, int hi, const char *alphabet, size_t **lengths)
+{
+    int k=(int)strlen(alphabet);
+    char **strings=(char**)malloc(n*sizeof(char*));
+    *lengths=(size_t*)malloc(n*sizeof(size_t));
+    for(size_t i=0;i<n;i++)
+    {
+        size_t len=(size_t)(lo+rand()%(hi-lo+1));
+        strings[i]=(char*)malloc(len+1);
+        for(size_t j=0;j<len;j++)
+            strings[i][j]=alphabet[rand()%k];
+        strings[i][len]='\0';
+        (*lengths)[i]=len;
+    }
+    return strings;
+}
+static void free_strings(char **strings, size_t *lengths, size_t n)
+{
+    for(size_t i=0;i<n;i++)
+        free(strings[i]);
+    free(strings);
+    free(lengths);
+}
+
+/*
+ * DFA_execute_batch must agree with DFA_execute_n string by string, for
+ * short strings (run directly) and long ones (interleaved) mixed. The
+ * timing of the two is in dfabench.
+ */
+static void check_batch(void)
+{
+    DFA dfa=containing("ashing");
+    size_t n=20000;
+    size_t *lengths;
+    char **strings=random_strings(n, 0, 200, "washingtonxyz", &lengths);
+    unsigned char *results=(unsigned char*)malloc((n+7)/8);
+    DFA_execute_batch(dfa, (const char *const *)strings, lengths, n, results);
+    bool agree=true;
+    size_t accepted=0;
+    for(size_t i=0;i<n;i++)
+    {
+        bool bit=(results[i/8]>>(i%8))&1;
+        if(bit!=DFA_execute_n(dfa, strings[i], lengths[i]))
+            agree=false;
+        accepted+=bit;
+    }
+    check(agree&&accepted>0&&accepted<n, "DFA_execute_batch agrees with DFA_execute_n");
+    DFA_execute_batch(dfa, (const char *const *)strings, NULL, n, results);
+    bool agreeNul=true;
+    for(size_t i=0;i<n;i++)
+        if(((results[i/8]>>(i%8))&1)!=DFA_execute_n(dfa, strings[i], lengths[i]))
+            agreeNul=false;
+    check(agreeNul, "DFA_execute_batch on null-terminated strings");
+    free_strings(strings, lengths, n);
+    free(results);
+    DFA_free(dfa);
+}
+
+/*
+ * DFA_multi_execute on the given input must report exactly the patterns
+ * listed in expected, which ends with -1.
+ */
+static bool union_matches(DFA_multi multi, char *input, const int *expected)
+{
+    const int *matched;
+    int count=DFA_multi_execute(multi, input, strlen(input), &matched);
+    for(int i=0;i<count;i++)
+        if(matched[i]!=expected[i])
+            return false;
+    return expected[count]==-1;
+}
+
+/*
+ * Three overlapping patterns run as one: strings containing "code",
+ * strings containing "ro", and strings starting with "code". Each input
+ * must report exactly the patterns that accept it on their own, whether
+ * that is all of them, some or none.
+ */
+static void check_union(void)
+{
+    NFA nfas[3]={word_NFA("code", true), word_NFA("ro", true), word_NFA("code", false)};
+    DFA_multi multi=Convert_union(nfas, 3);
+    check(union_matches(multi, "code rot", (int[]){0, 1, 2, -1}), "Convert_union: all three patterns");
+    check(union_matches(multi, "rocode", (int[]){0, 1, -1}), "Convert_union: \"code\" and \"ro\"");
+    check(union_matches(multi, "codex", (int[]){0, 2, -1}), "Convert_union: \"code\" twice");
+    check(union_matches(multi, "barcode", (int[]){0, -1}), "Convert_union: \"code\" alone");
+    check(union_matches(multi, "cod", (int[]){-1}), "Convert_union: no pattern");
+    check(union_matches(multi, "", (int[]){-1}), "Convert_union: empty input");
+    DFA dfas[3];
+    for(int p=0;p<3;p++)
+        dfas[p]=Convert(nfas[p]);
+    size_t n=20000;
+    size_t *lengths;
+    char **strings=random_strings(n, 0, 12, "cdeorx", &lengths);
+    bool agree=true;
+    for(size_t i=0;i<n;i++)
+    {
+        int expected[4];
+        int count=0;
+        for(int p=0;p<3;p++)
+            if(DFA_execute_n(dfas[p], strings[i], lengths[i]))
+                expected[count++]=p;
+        expected[count]=-1;
+        if(!union_matches(multi, strings[i], expected))
+            agree=false;
+    }
+    check(agree, "Convert_union agrees with each pattern's DFA");
+    free_strings(strings, lengths, n);
+    for(int p=0;p<3;p++)
+    {
+        DFA_free(dfas[p]);
+        NFA_free(nfas[p]);
+    }
+    DFA_multi_free(multi);
+}
+
+/*
+ * Thousands of patterns at once: pattern i is the strings starting with
+ * "p" and the digits of i, so an input like "p2999" matches the patterns
+ * for each of its prefixes (2, 29, 299 and 2999) and "q1" matches none.
+ */
+static void check_union_many(void)
+{
+    int count=3000;
+    NFA *nfas=(NFA*)malloc(sizeof(NFA)*count);
+    char word[16];
+    for(int i=0;i<count;i++)
+    {
+        sprintf(word, "p%d", i);
+        nfas[i]=word_NFA(word, false);
+    }
+    DFA_multi multi=Convert_union(nfas, count);
+    check(union_matches(multi, "p2999", (int[]){2, 29, 299, 2999, -1}), "Convert_union of 3000: four prefixes");
+    check(union_matches(multi, "p05x", (int[]){0, -1}), "Convert_union of 3000: one prefix");
+    check(union_matches(multi, "q1", (int[]){-1}), "Convert_union of 3000: no pattern");
+    check(union_matches(multi, "p", (int[]){-1}), "Convert_union of 3000: too short");
+    bool agree=true;
+    for(int run=0;run<5000;run++)
+    {
+        char input[8]="p";
+        int len=1+rand()%6;
+        for(int i=1;i<len;i++)
+            input[i]="0123456789"[rand()%10];
+        input[len]='\0';
+        //it matches the patterns spelled by its prefixes, leaving out
+        //those with a leading 0 ("p05" is not pattern 5)
+        int expected[8];
+        int matches=0;
+        int i=0;
+        for(int end=1;end<len&&(end==1||input[1]!='0');end++)
+        {
+            i=10*i+(input[end]-'0');
+            if(i<count)
+                expected[matches++]=i;
+        }
+        expected[matches]=-1;
+        if(!union_matches(multi, input, expected))
+            agree=false;
+    }
+    check(agree, "Convert_union of 3000 on random inputs");
+    for(int i=0;i<count;i++)
+        NFA_free(nfas[i]);
+    free(nfas);
+    DFA_multi_free(multi);
+}
+
+/*
+ * Feeding a DFA_stream an input in random pieces, empty ones included,
+ * must give the same answer as feeding it whole.
+ */
+static void check_stream(void)
+{
+    DFA dfa=containing("ashing");
+    size_t n=5000;
+    size_t *lengths;
+    char **strings=random_strings(n, 0, 60, "ashingx", &lengths);
+    bool agree=true;
+    size_t accepted=0;
+    for(size_t i=0;i<n;i++)
+    {
+        DFA_stream whole=DFA_stream_begin(dfa);
+        DFA_stream_feed(whole, strings[i], lengths[i]);
+        bool expected=DFA_stream_finish(whole);
+        DFA_stream pieces=DFA_stream_begin(dfa);
+        for(size_t at=0;at<lengths[i];)
+        {
+            size_t len=(size_t)rand()%(lengths[i]-at+1);
+            DFA_stream_feed(pieces, strings[i]+at, len);
+            at+=len;
+        }
+        if(DFA_stream_finish(pieces)!=expected||expected!=DFA_execute_n(dfa, strings[i], lengths[i]))
+            agree=false;
+        accepted+=expected;
+    }
+    check(agree&&accepted>0&&accepted<n, "DFA_stream gives the same answer whole and in pieces");
+    free_strings(strings, lengths, n);
+    DFA_free(dfa);
+}
+
+/*
+ * Run the given DFA on the given input with its Shuffle vectors and again
+ * with the plain table, and return true if the two agree.
+ */
+static bool shuffle_agrees(DFA dfa, const char *input, size_t len)
+{
+    unsigned char *shuffle=dfa->Shuffle;
+    bool with=DFA_execute_n(dfa, input, len);
+    dfa->Shuffle=NULL;
+    bool without=DFA_execute_n(dfa, input, len);
+    dfa->Shuffle=shuffle;
+    return with==without;
+}
+
+/*
+ * DFAs of at most 16 states run through their Shuffle vectors (with the
+ * pshufb engine when built with -mssse3), which must give the same
+ * answers as the table: a 16-state counter that never dies, a DFA that
+ * reaches the dead state, and random DFAs of 1 to 16 states. The inputs
+ * run from empty to several 16-byte blocks plus a tail.
+ */
+static void check_shuffle(void)
+{
+    //every byte has a transition, which DFA_set_transition can't give
+    //bytes past 127, so the counter is built as an NFA and converted
+    NFA nfa=new_NFA(16);
+    for(int s=0;s<16;s++)
+    {
+        NFA_add_transition_range(nfa, s, 0, 'a'-1, s);
+        NFA_add_transition(nfa, s, 'a', (s+1)%16);
+        NFA_add_transition_range(nfa, s, 'a'+1, 255, s);
+        NFA_set_accepting(nfa, s, s%5==0);
+    }
+    DFA counter=Convert(nfa);
+    NFA_free(nfa);
+    DFA prefix=new_DFA(3);
+    DFA_set_transition(prefix, 0, 'a', 1);
+    DFA_set_transition(prefix, 1, 'b', 2);
+    DFA_set_transition(prefix, 2, 'c', 2);
+    DFA_set_accepting(prefix, 2, true);
+    check(counter->TotalStates==16&&counter->Shuffle!=NULL&&prefix->Shuffle!=NULL, "DFAs of up to 16 states have Shuffle vectors");
+    size_t n=2000;
+    size_t *lengths;
+    char **strings=random_strings(n, 0, 100, "abcx", &lengths);
+    bool counterOk=true;
+    bool prefixOk=true;
+    for(size_t i=0;i<n;i++)
+    {
+        if(!shuffle_agrees(counter, strings[i], lengths[i]))
+            counterOk=false;
+        if(!shuffle_agrees(prefix, strings[i], lengths[i]))
+            prefixOk=false;
+    }
+    //and inputs that stay alive in prefix for a block or more first
+    char input[80]="ab";
+    for(int len=2;len<(int)sizeof(input)-1;len++)
+    {
+        input[len]='c';
+        input[len+1]='\0';
+        if(!shuffle_agrees(prefix, input, len+1))
+            prefixOk=false;
+        input[len]='x';
+        if(!shuffle_agrees(prefix, input, len+1))
+            prefixOk=false;
+        input[len]='c';
+    }
+    check(counterOk, "Shuffle agrees with the table on the 16-state counter");
+    check(prefixOk, "Shuffle agrees with the table through the dead state");
+    DFA_free(counter);
+    DFA_free(prefix);
+    bool randomOk=true;
+    for(int run=0;run<300;run++)
+    {
+        int states=1+rand()%16;
+        DFA dfa=new_DFA(states);
+        for(int s=0;s<states;s++)
+        {
+            for(const char *c="abc";*c!='\0';c++)
+                if(rand()%8!=0)
+                    DFA_set_transition(dfa, s, *c, rand()%states);
+            DFA_set_accepting(dfa, s, rand()%3==0);
+        }
+        for(size_t i=0;i<n;i+=10)
+            if(!shuffle_agrees(dfa, strings[i], lengths[i]))
+                randomOk=false;
+        DFA_free(dfa);
+    }
+    check(randomOk, "Shuffle agrees with the table on random DFAs");
+    free_strings(strings, lengths, n);
+}
+
+/*
+ * DFA_execute_parallel with 1 thread, 4 threads and more threads than
+ * there are chunks must agree with DFA_execute_n on the given input.
+ */
+static bool parallel_agrees(DFA dfa, const char *input, size_t len)
+{
+    bool expected=DFA_execute_n(dfa, input, len);
+    int threads[]={1, 4, 64};
+    for(int i=0;i<3;i++)
+        if(DFA_execute_parallel(dfa, input, len, threads[i])!=expected)
+            return false;
+    return true;
+}
+
+/*
+ * Inputs long enough for four chunks, on a permutation DFA (even numbers
+ * of 0s and 1s), on a DFA that dies in the middle of a chunk, and on one
+ * with too many states for Shuffle vectors.
+ */
+static void check_parallel(void)
+{
+    size_t len=4*DFA_PARALLEL_MIN_CHUNK+123;
+    char *input=(char *)malloc(len+1);
+    DFA even=new_DFA(4);
+    for(int s=0;s<4;s++)
+    {
+        DFA_set_transition(even, s, '0', s^1);
+        DFA_set_transition(even, s, '1', s^2);
+    }
+    DFA_set_accepting(even, 0, true);
+    bool evenOk=true;
+    int accepted=0;
+    //of even length, so that both counts can be even
+    for(int run=0;run<8;run++)
+    {
+        for(size_t i=0;i<len-1;i++)
+            input[i]="01"[rand()%2];
+        if(!parallel_agrees(even, input, len-1))
+            evenOk=false;
+        accepted+=DFA_execute_n(even, input, len-1);
+    }
+    check(evenOk&&accepted>0&&accepted<8, "DFA_execute_parallel on the even 0s and 1s DFA");
+    DFA_free(even);
+
+    DFA prefix=new_DFA(3);
+    DFA_set_transition(prefix, 0, 'a', 1);
+    DFA_set_transition(prefix, 1, 'b', 2);
+    DFA_set_transition(prefix, 2, 'c', 2);
+    DFA_set_accepting(prefix, 2, true);
+    memset(input, 'c', len);
+    input[0]='a';
+    input[1]='b';
+    bool alive=parallel_agrees(prefix, input, len)&&DFA_execute_n(prefix, input, len);
+    input[2*DFA_PARALLEL_MIN_CHUNK+1000]='x';
+    bool dead=parallel_agrees(prefix, input, len)&&!DFA_execute_n(prefix, input, len);
+    check(alive&&dead, "DFA_execute_parallel reaching the dead state mid-chunk");
+    DFA_free(prefix);
+
+    DFA word=containing("washingtonxyzabcd");
+    bool wordOk=word->TotalStates>16;
+    for(int run=0;run<2;run++)
+    {
+        for(size_t i=0;i<len;i++)
+            input[i]="washingtonxyzabcd"[rand()%17];
+        if(run==1)
+            memcpy(input+3*DFA_PARALLEL_MIN_CHUNK-5, "washingtonxyzabcd", 17);
+        if(!parallel_agrees(word, input, len)||DFA_execute_n(word, input, len)!=(run==1))
+            wordOk=false;
+    }
+    check(wordOk, "DFA_execute_parallel on a DFA of more than 16 states");
+    DFA_free(word);
+    free(input);
+}
+
+/*
+ * Return true if every state of the given DFA can be reached from state 0.
+ */
+static bool all_reachable(DFA dfa)
+{
+    int n=dfa->TotalStates;
+    int k=dfa->NumClasses;
+    bool *seen=(bool *)calloc(n+1, sizeof(bool));
+    int *queue=(int *)malloc(sizeof(int)*(n+1));
+    int count=0;
+    seen[0]=true;
+    queue[count++]=0;
+    for(int i=0;i<count;i++)
+    {
+        for(int c=0;c<k;c++)
+        {
+            int t=dfa->TransitionTable[queue[i]*k+c];
+            if(!seen[t])
+            {
+                seen[t]=true;
+                queue[count++]=t;
+            }
+        }
+    }
+    bool all=true;
+    for(int s=0;s<n;s++)
+        if(!seen[s])
+            all=false;
+    free(queue);
+    free(seen);
+    return all;
+}
+
+static const int *signatures;
+static int signatureLength;
+
+static int compare_signatures(const void *a, const void *b)
+{
+    const int *x=signatures+(size_t)*(const int *)a*signatureLength;
+    const int *y=signatures+(size_t)*(const int *)b*signatureLength;
+    return memcmp(x, y, sizeof(int)*signatureLength);
+}
+
+/*
+ * Return true if no two states of the given DFA, the dead state included,
+ * accept the same strings. Moore's refinement: states start out grouped
+ * by whether they accept, and are regrouped by their group and the groups
+ * they go to on each class until the number of groups stops growing.
+ */
+static bool all_distinct(DFA dfa)
+{
+    int N=dfa->TotalStates+1;
+    int k=dfa->NumClasses;
+    int *group=(int *)malloc(sizeof(int)*N);
+    int *order=(int *)malloc(sizeof(int)*N);
+    int *signature=(int *)malloc(sizeof(int)*(size_t)N*(k+1));
+    for(int s=0;s<N;s++)
+        group[s]=dfa->Accepting[s];
+    int groups=0;
+    for(int last=-1;groups!=last;)
+    {
+        last=groups;
+        for(int s=0;s<N;s++)
+        {
+            signature[(size_t)s*(k+1)]=group[s];
+            for(int c=0;c<k;c++)
+                signature[(size_t)s*(k+1)+1+c]=group[dfa->TransitionTable[s*k+c]];
+            order[s]=s;
+        }
+        signatures=signature;
+        signatureLength=k+1;
+        qsort(order, N, sizeof(int), compare_signatures);
+        groups=0;
+        for(int i=0;i<N;i++)
+        {
+            if(i>0&&compare_signatures(&order[i-1], &order[i])!=0)
+                groups++;
+            group[order[i]]=groups;
+        }
+        groups++;
+    }
+    free(signature);
+    free(order);
+    free(group);
+    return groups==N;
+}
+
+/*
+ * Return true if the two DFAs agree on many random strings over alphabet.
+ */
+static bool same_language(DFA a, DFA b, const char *alphabet)
+{
+    size_t n=5000;
+    size_t *lengths;
+    char **strings=random_strings(n, 0, 30, alphabet, &lengths);
+    bool same=true;
+    for(size_t i=0;i<n;i++)
+        if(DFA_execute_n(a, strings[i], lengths[i])!=DFA_execute_n(b, strings[i], lengths[i]))
+            same=false;
+    free_strings(strings, lengths, n);
+    return same;
+}
+
+/*
+ * DFA_minimize on its own: the subset construction for the Washington
+ * NFA (4096 states) comes down to 1534; a small DFA with two pairs of
+ * equivalent states and an unreachable one comes down to 3; and a DFA
+ * that accepts nothing is a single rejecting state. Each result must
+ * accept what its input did, reach all its states, and have no two that
+ * are equivalent.
+ */
+static void check_minimize(void)
+{
+    NFA nfa=initialWashington();
+    DFA full=Convert_unminimized(nfa);
+    DFA min=DFA_minimize(full);
+    check(full->TotalStates==4096&&min->TotalStates==1534, "DFA_minimize of Washington: 4096 states to 1534");
+    check(same_language(full, min, "washingtonxyz"), "DFA_minimize of Washington accepts the same strings");
+    check(all_reachable(min)&&all_distinct(min), "DFA_minimize of Washington is reachable and minimal");
+    DFA_free(min);
+    DFA_free(full);
+    NFA_free(nfa);
+
+    //0 goes to 1 on a and 2 on b, which are the same, and from them to 3
+    //and 4 on c, which are the same too; 5 can't be reached
+    DFA small=new_DFA(6);
+    DFA_set_transition(small, 0, 'a', 1);
+    DFA_set_transition(small, 0, 'b', 2);
+    DFA_set_transition(small, 1, 'c', 3);
+    DFA_set_transition(small, 2, 'c', 4);
+    DFA_set_transition(small, 5, 'a', 3);
+    DFA_set_accepting(small, 3, true);
+    DFA_set_accepting(small, 4, true);
+    DFA_set_accepting(small, 5, true);
+    min=DFA_minimize(small);
+    check(min->TotalStates==3&&same_language(small, min, "abcd")&&DFA_execute(min, "bc")&&!DFA_execute(min, "ab"),
+          "DFA_minimize of a small DFA: 6 states to 3");
+    check(all_reachable(min)&&all_distinct(min), "DFA_minimize of a small DFA is reachable and minimal");
+    DFA_free(min);
+    DFA_free(small);
+
+    DFA empty=new_DFA(2);
+    DFA_set_transition_all(empty, 0, 1);
+    DFA_set_transition_all(empty, 1, 0);
+    min=DFA_minimize(empty);
+    //its start state can't help being equivalent to the dead state
+    check(min->TotalStates==1&&!min->Accepting[0]&&!DFA_execute(min, "")&&!DFA_execute(min, "ab"),
+          "DFA_minimize of the empty language is one rejecting state");
+    DFA_free(min);
+    DFA_free(empty);
+}
+
+/*
+ * A DFA whose transitions split a new symbol class each time: built in an
+ * Arena, where nothing else is allocated after its table, the table must
+ * widen where it is, and the DFA must agree with the same one built with
+ * malloc.
+ */
+static void check_symbols(void)
+{
+    Arena arena=new_Arena(0);
+    DFA dfa[2]={new_DFA_in(arena, 21), new_DFA(21)};
+    int *table=NULL;
+    for(int d=0;d<2;d++)
+    {
+        //state i goes on to i+1 on the ith letter
+        for(int i=0;i<20;i++)
+        {
+            DFA_set_transition(dfa[d], i, (char)('a'+i), i+1);
+            if(d==0&&i==0)
+                table=dfa[0]->TransitionTable;
+        }
+        DFA_set_accepting(dfa[d], 20, true);
+    }
+    check(dfa[0]->NumClasses==21&&dfa[0]->TransitionTable==table, "DFA_set_symbols widens an Arena's table in place");
+    check(DFA_execute(dfa[0], "abcdefghijklmnopqrst")&&!DFA_execute(dfa[0], "abcdefghijklmnopqrs")
+          &&same_language(dfa[0], dfa[1], "abcdefghijklmnopqrstu"), "a DFA built in an Arena agrees with one built with malloc");
+    DFA_free(dfa[1]);
+    Arena_free(arena);
+}
+
+int main(int argc, char **argv)
+{
+    srand(173);
+    check_batch();
+    check_union();
+    check_union_many();
+    check_stream();
+    check_shuffle();
+    check_parallel();
+    check_minimize();
+    check_symbols();
+    return failures>0;
+}
+
+#endif
@@ -9,8 +9,10 @@
 #define _dfa_h
 
 #include <stdbool.h>
+#include <stddef.h>
 #include "IntHashSet.h"
 #include "LinkedList.h"
+#include "Arena.h"
 #include "nfa.h"
 /**
  * The data structure used to represent a deterministic finite automaton.
@@ -22,17 +24,35 @@
 typedef struct DFA *DFA;
 struct DFA
 {
+    Arena arena;                  // where the DFA's memory comes from (NULL for malloc)
     int TotalStates;
-    int AcceptIndex;
-    int *Accept;
-    int *TransitionTable[128];
+    bool *Accepting;              // per-state accept flag
+    int NumClasses;               // columns per row of TransitionTable
+    unsigned char ByteClass[256]; // input byte -> column (symbol equivalence class)
+    int *TransitionTable;         // TotalStates+1 rows of NumClasses entries, one allocation
+    unsigned char *Shuffle;       // for DFAs of at most 16 states: per class, next state of each state
 };
 
+/**
+ * Number of input symbols that can label a DFA transition (0..127).
+ * Symbols are grouped into equivalence classes as transitions are set, so
+ * the transition from state src on symbol sym is stored at
+ * TransitionTable[src * NumClasses + ByteClass[sym]]. A missing transition
+ * is stored as the extra dead state TotalStates (reported as -1).
+ */
+#define DFA_SYMBOLS 128
+
 /**
  * Allocate and return a new DFA containing the given number of states.
  */
 extern DFA new_DFA(int nstates);
 
+/**
+ * Allocate and return a new DFA like new_DFA(), whose memory comes from
+ * the given Arena. DFA_free() then releases nothing that the Arena owns.
+ */
+extern DFA new_DFA_in(Arena arena, int nstates);
+
 /**
  * Free the given DFA.
  */
@@ -84,14 +104,109 @@ extern bool DFA_get_accepting(DFA dfa, int state);
  */
 extern bool DFA_execute(DFA dfa, char *input);
 
+/**
+ * Run the given DFA on the len bytes starting at buf, which need not be
+ * null-terminated, and return true if it accepts them, otherwise false.
+ */
+extern bool DFA_execute_n(DFA dfa, const char *buf, size_t len);
+
+/**
+ * Run the given DFA on each of the n given strings, several at a time,
+ * and set bit i of results (results[i/8] & (1 << i%8)) if it accepts
+ * strings[i]. The caller provides (n+7)/8 bytes of results. If lengths is
+ * NULL the strings must be null-terminated. Interleaving the strings pays
+ * off for strings of 16 bytes or more in an optimized build (dfabench
+ * times it); shorter ones are just run in turn.
+ */
+extern void DFA_execute_batch(DFA dfa, const char *const *strings, const size_t *lengths, size_t n, unsigned char *results);
+
+/**
+ * Run the given DFA on the len bytes starting at buf using up to nthreads
+ * threads, and return true if it accepts them, otherwise false. Each
+ * thread maps every start state to the state its piece of the input leads
+ * to, and the maps are then chained together from the first piece. Worth
+ * it for long inputs and DFAs with few states.
+ */
+extern bool DFA_execute_parallel(DFA dfa, const char *buf, size_t len, int nthreads);
+
+// Partial declaration
+typedef struct DFA_stream *DFA_stream;
+
+/**
+ * Start running the given DFA on input that will be supplied in chunks.
+ * Pass the result to DFA_stream_finish() when the input is done.
+ */
+extern DFA_stream DFA_stream_begin(DFA dfa);
+
+/**
+ * Run the given DFA_stream over the next len bytes of its input.
+ */
+extern void DFA_stream_feed(DFA_stream stream, const char *chunk, size_t len);
+
+/**
+ * Return true if the DFA accepts all the input fed to the given DFA_stream,
+ * otherwise false. This also frees the DFA_stream.
+ */
+extern bool DFA_stream_finish(DFA_stream stream);
+
 /**
  * Print the given DFA to System.out.
  */
 extern void DFA_print(DFA dfa);
 
-extern bool ifContains(LinkedList list,IntHashSet set);
+/**
+ * Return a new DFA equivalent to the given NFA, built by the subset
+ * construction and then minimized with DFA_minimize().
+ */
+extern DFA Convert(NFA nfa);
 
-extern int findindex(LinkedList list, IntHashSet set);
+/**
+ * Like Convert(), but allocate the DFA in the given Arena. Either way the
+ * working storage of the subset construction comes from an Arena of its
+ * own that is freed all at once at the end.
+ */
+extern DFA Convert_in(Arena arena, NFA nfa);
 
-extern DFA Convert(NFA nfa);
+/**
+ * Like Convert(), but return the DFA from the subset construction as is.
+ */
+extern DFA Convert_unminimized(NFA nfa);
+
+// Partial declaration
+typedef struct DFA_multi *DFA_multi;
+
+/**
+ * Return a DFA_multi that runs all of the count given NFAs (patterns) at
+ * once: their union (see NFA_union) goes through the subset construction
+ * with each DFA state labeled by the set of patterns whose accepting
+ * states it holds, and is minimized keeping states with different sets
+ * apart. Matching is then one pass over the input whatever the number of
+ * patterns.
+ */
+extern DFA_multi Convert_union(NFA *nfas, int count);
+
+/**
+ * Free the given DFA_multi.
+ */
+extern void DFA_multi_free(DFA_multi multi);
+
+/**
+ * Run the given DFA_multi on the len bytes starting at buf, and return how
+ * many of its patterns accept them. If matched isn't NULL, *matched is set
+ * to their indexes, in increasing order, in an array that belongs to the
+ * DFA_multi. Nothing is changed by a run, so threads may share a DFA_multi.
+ */
+extern int DFA_multi_execute(DFA_multi multi, const char *buf, size_t len, const int **matched);
+
+/**
+ * Return a new DFA with the fewest states that accepts the same strings as
+ * the given DFA (Hopcroft's algorithm). Unreachable states are dropped and
+ * the states are renumbered from 0, the start state.
+ */
+extern DFA DFA_minimize(DFA dfa);
+
+/**
+ * Like DFA_minimize(), but allocate the result in the given Arena.
+ */
+extern DFA DFA_minimize_in(Arena arena, DFA dfa);
 #endif
@@ -0,0 +1,95 @@
+/*
+ * File: dfabench.c
+ *
+ * Time DFA_execute_batch against a plain loop of DFA_execute_n over the
+ * same strings, for some of the project's automata on random strings of
+ * 20 to 200 bytes, long enough for the batch to interleave them. Build
+ * it with optimization (e.g. make dfabench CFLAGS='-O2 -std=c99'), and
+ * with -mavx2 or -mssse3 to time those builds.
+ *
+ * usage: dfabench [strings]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dfa.h"
+#include "nfa.h"
+#include "automata.h"
+
+#define RUNS 3
+
+static double seconds(clock_t start)
+{
+    return (double)(clock()-start)/CLOCKS_PER_SEC;
+}
+
+/*
+ * Time the loop and the batch over n random strings drawn from alphabet,
+ * taking the best of RUNS runs of each, and print both.
+ */
+static void bench(const char *name, DFA dfa, size_t n, const char *alphabet)
+{
+    int k=(int)strlen(alphabet);
+    char **strings=(char **)malloc(n*sizeof(char *));
+    size_t *lengths=(size_t *)malloc(n*sizeof(size_t));
+    for(size_t i=0;i<n;i++)
+    {
+        lengths[i]=(size_t)(20+rand()%181);
+        strings[i]=(char *)malloc(lengths[i]+1);
+        for(size_t j=0;j<lengths[i];j++)
+            strings[i][j]=alphabet[rand()%k];
+        strings[i][lengths[i]]='\0';
+    }
+    unsigned char *results=(unsigned char *)malloc((n+7)/8);
+    double loop=0, batch=0;
+    size_t loopAccepted=0;
+    for(int run=0;run<RUNS;run++)
+    {
+        //alternate the two so that neither always gets the warm cache
+        clock_t start=clock();
+        loopAccepted=0;
+        for(size_t i=0;i<n;i++)
+            loopAccepted+=DFA_execute_n(dfa, strings[i], lengths[i]);
+        double t=seconds(start);
+        if(run==0||t<loop)
+            loop=t;
+        start=clock();
+        DFA_execute_batch(dfa, (const char *const *)strings, lengths, n, results);
+        t=seconds(start);
+        if(run==0||t<batch)
+            batch=t;
+    }
+    size_t batchAccepted=0;
+    for(size_t i=0;i<n;i++)
+        batchAccepted+=(results[i/8]>>(i%8))&1;
+    printf("%-12s loop %.3fs  batch %.3fs  (%.2fx)%s\n", name, loop, batch, batch>0?loop/batch:0,
+           loopAccepted==batchAccepted?"":"  RESULTS DIFFER");
+    for(size_t i=0;i<n;i++)
+        free(strings[i]);
+    free(strings);
+    free(lengths);
+    free(results);
+}
+
+int main(int argc, char **argv)
+{
+    size_t n=argc>1?(size_t)atol(argv[1]):300000;
+    srand(173);
+    printf("%zu strings of 20 to 200 bytes, best of %d runs\n", n, RUNS);
+    DFA even01=initialeven01();
+    bench("even01", even01, n, "01");
+    DFA_free(even01);
+    NFA nfa=initialWashington();
+    DFA washington=Convert(nfa);
+    NFA_free(nfa);
+    bench("washington", washington, n, "washingtonxyz");
+    DFA_free(washington);
+    nfa=initialcontaincode();
+    DFA containcode=Convert(nfa);
+    NFA_free(nfa);
+    bench("containcode", containcode, n, "codexyz");
+    DFA_free(containcode);
+    return 0;
+}
@@ -0,0 +1,283 @@
+/*
+ * File: dfagrep.c
+ *
+ * Print (or count) the lines of a file accepted by one of the project's
+ * automata, or with -e matched in full by a regular expression (see
+ * nfa_regex.h), or by any of several given with -e each. The file is
+ * memory-mapped and split into one chunk per thread on line boundaries,
+ * and each thread runs the DFA over the lines of its chunk. NFAs are
+ * converted to a DFA first, or with -l each thread runs them through its
+ * own LazyDFA.
+ *
+ * usage: dfagrep [-c] [-l] [-t threads] (automaton | -e pattern ...) file
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "dfa.h"
+#include "nfa.h"
+#include "automata.h"
+#include "lazydfa.h"
+#include "nfa_regex.h"
+
+#define LAZY_CACHE_BYTES (16<<20)
+
+struct Automaton {
+    const char *name;
+    DFA (*dfa)();
+    NFA (*nfa)();
+};
+
+static const struct Automaton automata[] = {
+    { "csc173", initialcsc173, NULL },
+    { "cat", initialcat, NULL },
+    { "binary", initialbinary, NULL },
+    { "even01", initialeven01, NULL },
+    { "contain01", initialcontain01, NULL },
+    { "endcode", NULL, initialendcode },
+    { "containcode", NULL, initialcontaincode },
+    { "washington", NULL, initialWashington },
+    { "bari", NULL, initialbari },
+};
+#define NUM_AUTOMATA (sizeof(automata)/sizeof(automata[0]))
+
+/*
+ * One thread's share of the file, and what it found there. Matching lines
+ * are kept as (offset, length) pairs so they can be printed in file order
+ * once all the threads are done.
+ */
+struct Chunk {
+    DFA dfa;
+    NFA nfa;
+    const char *data;
+    size_t start;
+    size_t end;
+    bool keep;
+    size_t count;
+    size_t *lines;
+    size_t nlines;
+    size_t capacity;
+};
+
+static void *scan_chunk(void *arg)
+{
+    struct Chunk *chunk=arg;
+    const char *data=chunk->data;
+    LazyDFA lazy=chunk->nfa!=NULL?new_LazyDFA(chunk->nfa, LAZY_CACHE_BYTES):NULL;
+    size_t pos=chunk->start;
+    while(pos<chunk->end)
+    {
+        const char *newline=memchr(data+pos, '\n', chunk->end-pos);
+        size_t len=newline!=NULL?(size_t)(newline-(data+pos)):chunk->end-pos;
+        bool match=lazy!=NULL?LazyDFA_execute(lazy, data+pos, len)
+                              :DFA_execute_n(chunk->dfa, data+pos, len);
+        if(match)
+        {
+            chunk->count++;
+            if(chunk->keep)
+            {
+                if(chunk->nlines+2>chunk->capacity)
+                {
+                    chunk->capacity=chunk->capacity?2*chunk->capacity:256;
+                    chunk->lines=realloc(chunk->lines, chunk->capacity*sizeof(size_t));
+                }
+                chunk->lines[chunk->nlines++]=pos;
+                chunk->lines[chunk->nlines++]=len;
+            }
+        }
+        pos+=len+1;
+    }
+    LazyDFA_free(lazy);
+    return NULL;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: dfagrep [-c] [-l] [-t threads] (automaton | -e pattern ...) file\n");
+    fprintf(stderr, "automata:");
+    for(size_t i=0;i<NUM_AUTOMATA;i++)
+        fprintf(stderr, " %s", automata[i].name);
+    fprintf(stderr, "\n");
+    exit(2);
+}
+
+int main(int argc, char *argv[])
+{
+    bool countOnly=false;
+    bool lazy=false;
+    long nthreads=sysconf(_SC_NPROCESSORS_ONLN);
+    const char **patterns=malloc(sizeof(char *)*argc);
+    int npatterns=0;
+    int opt;
+    while((opt=getopt(argc, argv, "ce:lt:"))!=-1)
+    {
+        if(opt=='c')
+            countOnly=true;
+        else if(opt=='e')
+            patterns[npatterns++]=optarg;
+        else if(opt=='l')
+            lazy=true;
+        else if(opt=='t')
+            nthreads=atol(optarg);
+        else
+            usage();
+    }
+    if(argc-optind!=(npatterns>0?1:2))
+        usage();
+    if(nthreads<1)
+        nthreads=1;
+
+    DFA dfa=NULL;
+    NFA nfa=NULL;
+    if(npatterns>0)
+    {
+        NFA *nfas=malloc(sizeof(NFA)*npatterns);
+        for(int i=0;i<npatterns;i++)
+        {
+            const char *error;
+            nfas[i]=Regex_compile(patterns[i], &error);
+            if(nfas[i]==NULL)
+            {
+                fprintf(stderr, "dfagrep: %s: %s\n", patterns[i], error);
+                return 2;
+            }
+        }
+        if(npatterns==1)
+        {
+            nfa=nfas[0];
+        }
+        else
+        {
+            nfa=NFA_union(nfas, npatterns, NULL);
+            for(int i=0;i<npatterns;i++)
+                NFA_free(nfas[i]);
+        }
+        free(nfas);
+    }
+    else
+    {
+        for(size_t i=0;i<NUM_AUTOMATA;i++)
+        {
+            if(strcmp(argv[optind], automata[i].name)==0)
+            {
+                if(automata[i].dfa!=NULL)
+                    dfa=automata[i].dfa();
+                else
+                    nfa=automata[i].nfa();
+            }
+        }
+        if(dfa==NULL&&nfa==NULL)
+            usage();
+    }
+    if(nfa!=NULL)
+    {
+        if(!lazy)
+        {
+            dfa=Convert(nfa);
+            NFA_free(nfa);
+            nfa=NULL;
+        }
+        else
+        {
+            //the threads' LazyDFAs share it read-only
+            NFA_compile(nfa);
+        }
+    }
+
+    const char *filename=argv[argc-1];
+    int fd=open(filename, O_RDONLY);
+    struct stat st;
+    if(fd<0||fstat(fd, &st)<0)
+    {
+        perror(filename);
+        return 2;
+    }
+    size_t size=(size_t)st.st_size;
+    const char *data=NULL;
+    if(size>0)
+    {
+        data=mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(data==MAP_FAILED)
+        {
+            perror(filename);
+            return 2;
+        }
+        posix_madvise((void *)data, size, POSIX_MADV_SEQUENTIAL);
+    }
+    close(fd);
+
+    //split on line boundaries: each chunk ends just after a newline
+    if((size_t)nthreads>size/4096+1)
+        nthreads=(long)(size/4096+1);
+    struct Chunk *chunks=calloc(nthreads, sizeof(struct Chunk));
+    pthread_t *threads=malloc(nthreads*sizeof(pthread_t));
+    bool *started=malloc(nthreads*sizeof(bool));
+    size_t start=0;
+    for(long t=0;t<nthreads;t++)
+    {
+        size_t end=t==nthreads-1?size:size/nthreads*(t+1);
+        if(end<start)
+            end=start;
+        if(end<size)
+        {
+            const char *newline=memchr(data+end, '\n', size-end);
+            end=newline!=NULL?(size_t)(newline-data)+1:size;
+        }
+        chunks[t].dfa=dfa;
+        chunks[t].nfa=nfa;
+        chunks[t].data=data;
+        chunks[t].start=start;
+        chunks[t].end=end;
+        chunks[t].keep=!countOnly;
+        start=end;
+    }
+    for(long t=0;t<nthreads;t++)
+    {
+        //if there's no thread for a chunk, scan it here instead
+        started[t]=pthread_create(&threads[t], NULL, scan_chunk, &chunks[t])==0;
+        if(!started[t])
+            scan_chunk(&chunks[t]);
+    }
+    size_t count=0;
+    for(long t=0;t<nthreads;t++)
+    {
+        if(started[t])
+            pthread_join(threads[t], NULL);
+        count+=chunks[t].count;
+    }
+
+    if(countOnly)
+    {
+        printf("%zu\n", count);
+    }
+    else
+    {
+        for(long t=0;t<nthreads;t++)
+        {
+            for(size_t i=0;i<chunks[t].nlines;i+=2)
+            {
+                fwrite(data+chunks[t].lines[i], 1, chunks[t].lines[i+1], stdout);
+                putchar('\n');
+            }
+            free(chunks[t].lines);
+        }
+    }
+
+    free(started);
+    free(threads);
+    free(chunks);
+    free(patterns);
+    if(size>0)
+        munmap((void *)data, size);
+    DFA_free(dfa);
+    NFA_free(nfa);
+    return count>0?0:1;
+}
@@ -0,0 +1,284 @@
+/*
+ * File: lazydfa.c
+ *
+ * Lazy subset construction: a DFA state is a set of NFA states, and the
+ * transition from a state on a symbol class is worked out (and cached)
+ * the first time a run takes it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "lazydfa.h"
+#include "Set.h"
+#include "SetTable.h"
+
+#define UNKNOWN -1
+#define MIN_CAPACITY 16
+
+struct LazyDFA {
+    NFA nfa;
+    size_t MaxBytes;
+    size_t Bytes;                 // memory in the cached sets and in Accepting and TransitionTable
+    int NumClasses;
+    unsigned char ByteClass[256];
+    Set StartSet;
+    int Start;                    // cached state for StartSet, or UNKNOWN
+    int Dead;                     // cached state for the empty set, or UNKNOWN
+    SetTable States;              // state -> set of NFA states
+    int Capacity;
+    bool *Accepting;
+    int *TransitionTable;         // Capacity rows of NumClasses entries, UNKNOWN until taken
+};
+
+/*
+ * The bytes each state takes in Accepting and TransitionTable.
+ */
+static size_t LazyDFA_row_bytes(LazyDFA lazy)
+{
+    return sizeof(bool)+sizeof(int)*(size_t)lazy->NumClasses;
+}
+
+/*
+ * Make room for the given number of states in Accepting and
+ * TransitionTable, growing or shrinking them.
+ */
+static void LazyDFA_resize(LazyDFA lazy, int capacity)
+{
+    lazy->Bytes-=(size_t)lazy->Capacity*LazyDFA_row_bytes(lazy);
+    lazy->Capacity=capacity;
+    lazy->Accepting=(bool *)realloc(lazy->Accepting, sizeof(bool)*capacity);
+    lazy->TransitionTable=(int *)realloc(lazy->TransitionTable, sizeof(int)*(size_t)capacity*lazy->NumClasses);
+    lazy->Bytes+=(size_t)capacity*LazyDFA_row_bytes(lazy);
+}
+
+/*
+ * Return true if adding the given set as a state would take the cache
+ * past MaxBytes: the set, and if the tables are full, their doubling (the
+ * SetTable doubles along with Accepting and TransitionTable, to about
+ * twice its size).
+ */
+static bool LazyDFA_full(LazyDFA lazy, Set set)
+{
+    size_t bytes=lazy->Bytes+SetTable_bytes(lazy->States)+Set_bytes(set);
+    if(SetTable_count(lazy->States)==lazy->Capacity)
+        bytes+=(size_t)lazy->Capacity*LazyDFA_row_bytes(lazy)+SetTable_bytes(lazy->States);
+    return bytes>lazy->MaxBytes;
+}
+
+/*
+ * Empty the cache, shrinking Accepting and TransitionTable back to their
+ * starting size, so that the memory in use is again well under MaxBytes.
+ */
+static void LazyDFA_flush(LazyDFA lazy)
+{
+    SetTable_clear(lazy->States, true);
+    lazy->Bytes=0;
+    LazyDFA_resize(lazy, MIN_CAPACITY);
+    lazy->Start=UNKNOWN;
+    lazy->Dead=UNKNOWN;
+}
+
+/*
+ * Add the given set (which the LazyDFA now owns) as a new state, with no
+ * transitions worked out yet, and return it.
+ */
+static int LazyDFA_add(LazyDFA lazy, Set set)
+{
+    int state=SetTable_add(lazy->States, set);
+    if(state==lazy->Capacity)
+        LazyDFA_resize(lazy, 2*lazy->Capacity);
+    lazy->Accepting[state]=false;
+    SetIterator iterator=Set_iterator(set);
+    while(SetIterator_hasNext(iterator))
+    {
+        if(NFA_get_accepting(lazy->nfa, SetIterator_next(iterator)))
+        {
+            lazy->Accepting[state]=true;
+            break;
+        }
+    }
+    free(iterator);
+    for(int c=0;c<lazy->NumClasses;c++)
+    {
+        lazy->TransitionTable[(size_t)state*lazy->NumClasses+c]=UNKNOWN;
+    }
+    lazy->Bytes+=Set_bytes(set);
+    if(Set_isEmpty(set))
+        lazy->Dead=state;
+    return state;
+}
+
+/*
+ * Return the state for the given set, adding it if it isn't cached. The
+ * set is either kept by the LazyDFA or freed.
+ */
+static int LazyDFA_intern(LazyDFA lazy, Set set)
+{
+    int state=SetTable_lookup(lazy->States, set);
+    if(state!=UNKNOWN)
+    {
+        Set_free(set);
+        return state;
+    }
+    return LazyDFA_add(lazy, set);
+}
+
+/*
+ * Work out the transition from the given state on the given class, and
+ * return the state it leads to. If that state is new and the cache is
+ * full, the cache is flushed first, so the source state is re-added and
+ * the returned state may be numbered differently than before.
+ */
+static int LazyDFA_step(LazyDFA lazy, int state, int c)
+{
+    NFA nfa=lazy->nfa;
+    Set next=new_Set(nfa->TotalStates);
+    SetIterator iterator=Set_iterator(SetTable_get(lazy->States, state));
+    while(SetIterator_hasNext(iterator))
+    {
+        size_t row=(size_t)SetIterator_next(iterator)*lazy->NumClasses+c;
+        for(int i=nfa->Offsets[row];i<nfa->Offsets[row+1];i++)
+        {
+            Set_insert(next, nfa->Successors[i]);
+        }
+    }
+    free(iterator);
+    int dst=SetTable_lookup(lazy->States, next);
+    if(dst!=UNKNOWN)
+    {
+        Set_free(next);
+    }
+    else
+    {
+        if(LazyDFA_full(lazy, next))
+        {
+            //keep a copy of the source set across the flush
+            Set source=new_Set(lazy->nfa->TotalStates);
+            Set_union(source, SetTable_get(lazy->States, state));
+            LazyDFA_flush(lazy);
+            state=LazyDFA_add(lazy, source);
+        }
+        dst=LazyDFA_intern(lazy, next);
+    }
+    lazy->TransitionTable[(size_t)state*lazy->NumClasses+c]=dst;
+    return dst;
+}
+
+LazyDFA new_LazyDFA(NFA nfa, size_t max_bytes)
+{
+    LazyDFA lazy=(LazyDFA)malloc(sizeof(struct LazyDFA));
+    lazy->nfa=nfa;
+    lazy->MaxBytes=max_bytes;
+    lazy->NumClasses=NFA_byte_classes(nfa, lazy->ByteClass);
+    lazy->StartSet=new_Set(nfa->TotalStates);
+    for(int i=0;i<nfa->NumStart;i++)
+    {
+        Set_insert(lazy->StartSet, nfa->Start[i]);
+    }
+    lazy->Start=UNKNOWN;
+    lazy->Dead=UNKNOWN;
+    lazy->States=new_SetTable();
+    lazy->Bytes=0;
+    lazy->Capacity=0;
+    lazy->Accepting=NULL;
+    lazy->TransitionTable=NULL;
+    LazyDFA_resize(lazy, MIN_CAPACITY);
+    return lazy;
+}
+
+void LazyDFA_free(LazyDFA lazy)
+{
+    if(lazy==NULL)
+        return;
+    SetTable_free(lazy->States, true);
+    Set_free(lazy->StartSet);
+    free(lazy->TransitionTable);
+    free(lazy->Accepting);
+    free(lazy);
+}
+
+int LazyDFA_get_size(LazyDFA lazy)
+{
+    return SetTable_count(lazy->States);
+}
+
+bool LazyDFA_execute(LazyDFA lazy, const char *buf, size_t len)
+{
+    if(lazy->Start==UNKNOWN)
+    {
+        Set start=new_Set(lazy->nfa->TotalStates);
+        Set_union(start, lazy->StartSet);
+        if(SetTable_lookup(lazy->States, start)==UNKNOWN&&LazyDFA_full(lazy, start))
+            LazyDFA_flush(lazy);
+        lazy->Start=LazyDFA_intern(lazy, start);
+    }
+    const unsigned char *input=(const unsigned char *)buf;
+    int state=lazy->Start;
+    for(size_t i=0;i<len;i++)
+    {
+        int c=lazy->ByteClass[input[i]];
+        int next=lazy->TransitionTable[(size_t)state*lazy->NumClasses+c];
+        if(next==UNKNOWN)
+            next=LazyDFA_step(lazy, state, c);
+        state=next;
+        if(state==lazy->Dead)
+            return false;
+    }
+    return lazy->Accepting[state];
+}
+
+#ifdef MAIN
+
+#include "check.h"
+
+/*
+ * The strings over {a,b} whose nth-last character is a need 2^n DFA
+ * states, far more than a cache of a few kilobytes holds, so random
+ * inputs keep flushing it. Every answer must still be the NFA's.
+ */
+static void check_flush(void)
+{
+    int n=8;
+    NFA nfa=new_NFA(n+1);
+    NFA_add_transition_str(nfa, 0, "ab", 0);
+    NFA_add_transition(nfa, 0, 'a', 1);
+    for(int i=1;i<n;i++)
+        NFA_add_transition_str(nfa, i, "ab", i+1);
+    NFA_set_accepting(nfa, n, true);
+    LazyDFA lazy=new_LazyDFA(nfa, 4096);
+    bool agree=true;
+    int flushes=0;
+    int accepted=0;
+    size_t most=0;
+    char input[41];
+    for(int run=0;run<2000;run++)
+    {
+        int len=rand()%(int)sizeof(input);
+        for(int i=0;i<len;i++)
+            input[i]="ab"[rand()%2];
+        input[len]='\0';
+        int before=LazyDFA_get_size(lazy);
+        bool result=LazyDFA_execute(lazy, input, (size_t)len);
+        if(LazyDFA_get_size(lazy)<before)
+            flushes++;
+        if(lazy->Bytes+SetTable_bytes(lazy->States)>most)
+            most=lazy->Bytes+SetTable_bytes(lazy->States);
+        if(result!=NFA_execute(nfa, input))
+            agree=false;
+        accepted+=result;
+    }
+    check(flushes>0, "LazyDFA with a small cache flushes it");
+    check(most<=4096, "LazyDFA keeps its cache within max_bytes");
+    check(agree&&accepted>0&&accepted<2000, "LazyDFA agrees with NFA_execute across flushes");
+    LazyDFA_free(lazy);
+    NFA_free(nfa);
+}
+
+int main(int argc, char **argv)
+{
+    srand(173);
+    check_flush();
+    return failures>0;
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * File: lazydfa.h
+ *
+ * A LazyDFA runs an NFA as a DFA whose states (sets of NFA states) are
+ * built only when the input first needs them, and kept in a cache of
+ * bounded size that is flushed when it fills up.
+ */
+
+#ifndef _lazydfa_h
+#define _lazydfa_h
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "nfa.h"
+
+// Partial declaration
+typedef struct LazyDFA *LazyDFA;
+
+/**
+ * Allocate and return a new LazyDFA for the given NFA whose state cache
+ * (the sets of NFA states, their index and the transition table) uses
+ * about max_bytes of memory at most. This compiles the NFA if it
+ * isn't already (see NFA_compile). The NFA must not be changed or freed
+ * while the LazyDFA is in use.
+ */
+extern LazyDFA new_LazyDFA(NFA nfa, size_t max_bytes);
+
+/**
+ * Free the given LazyDFA (but not its NFA).
+ */
+extern void LazyDFA_free(LazyDFA lazy);
+
+/**
+ * Return the number of DFA states currently in the given LazyDFA's cache.
+ */
+extern int LazyDFA_get_size(LazyDFA lazy);
+
+/**
+ * Run the given LazyDFA on the len bytes starting at buf, and return true
+ * if its NFA accepts them, otherwise false. States and transitions built
+ * along the way stay cached for later runs.
+ */
+extern bool LazyDFA_execute(LazyDFA lazy, const char *buf, size_t len);
+
+#endif
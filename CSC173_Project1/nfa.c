@@ -1,159 +1,771 @@
-#include "nfa.h"
-#include <stdlib.h>
-#include <stdbool.h>
-#include <stdio.h>
-#include <string.h>
-#include "IntHashSet.h"
-#include "LinkedList.h"
-
-NFA new_NFA(int nstates){
-	NFA this=(NFA)malloc(sizeof(struct NFA));
-	this->TotalStates=nstates;
-	this->Accept=(int *)malloc(nstates*sizeof(int));
-	this->AcceptIndex=0;
-	for(int i=0;i<this->TotalStates;i++){
-		this->TransitionTable[i]=(IntHashSet*)malloc(128*sizeof(IntHashSet));
-	}
-	for(int i=0;i<this->TotalStates;i++){
-		for(int x=0;x<128;x++){
-			this->TransitionTable[i][x]=new_IntHashSet(nstates);
-		}
-	}
-	return this;
-}
-void NFA_free(NFA nfa)
-{
-    if(nfa==NULL)
-        return;
-    for(int i=0;i<nfa->TotalStates;i++)
-    {
-        for(int j=0;j<128;j++)
-            IntHashSet_free(nfa->TransitionTable[i][j]);
-        free(nfa->TransitionTable[i]);
-    }
-    free(nfa->TransitionTable);
-    free(nfa->Accept);
-    free(nfa);
-    return;
-}
-int NFA_get_size(NFA nfa)
-{
-    return nfa->TotalStates;
-}
-IntHashSet NFA_get_transitions(NFA nfa, int state, char sym)
-{
-    if(state>nfa->TotalStates||state<0)
-    {
-        printf("%s\n","input error");
-        return NULL;
-    }
-    int temp=(int)sym;
-    return nfa->TransitionTable[state][temp];
-}
-void NFA_add_transition(NFA nfa, int src, char sym, int dst)
-{
-    if(src>nfa->TotalStates||src<0||dst>nfa->TotalStates||dst<0)
-    {
-        printf("%s\n","input error");
-        return;
-    }
-    int temp=(int) sym;
-    IntHashSet_insert(nfa->TransitionTable[src][temp], dst);
-}
-void NFA_add_transition_str(NFA nfa, int src, char *str, int dst)
-{
-    if(src>nfa->TotalStates||src<0||dst>nfa->TotalStates||dst<0)
-    {
-        printf("%s\n","input error");
-        return;
-    }
-    int length=(int) strlen(str);
-    for(int i=0;i<length;i++)
-    {
-        int temp=(int)str[i];
-        IntHashSet_insert(nfa->TransitionTable[src][temp], dst);
-    }
-}
-void NFA_add_transition_all(NFA nfa, int src, int dst)
-{
-    if(src>nfa->TotalStates||src<0||dst>nfa->TotalStates||dst<0)
-    {
-        printf("%s\n","input error");
-        return;
-    }
-    for(int i=0;i<128;i++)
-    {
-        IntHashSet_insert(nfa->TransitionTable[src][i], dst);
-    }
-}
-void NFA_add_transition_Except(NFA nfa,int src,char string,int dst)
-{
-    if(src>nfa->TotalStates||src<0||dst>nfa->TotalStates||dst<0)
-    {
-        printf("%s\n","input error");
-        return;
-    }
-    for(int i=0;i<128;i++)
-    {
-        if((int)string==i)
-        {
-            continue;
-        }
-        IntHashSet_insert(nfa->TransitionTable[src][i], dst);
-    }
-}
-void NFA_set_accepting(NFA nfa, int state, bool value)
-{
-    if(value==0)
-        return;
-    if(state<0||state>nfa->TotalStates)
-        return;
-    nfa->Accept[nfa->AcceptIndex]=state;
-    nfa->AcceptIndex++;
-}
- bool NFA_get_accepting(NFA nfa, int state)
-{
-    for(int i=0;i<nfa->AcceptIndex;i++)
-    {
-        if(nfa->Accept[i]==state)
-            return 1;
-    }
-    return 0;
-}
-bool NFA_execute(NFA nfa, char *input)
-{
-    IntHashSet temp=new_IntHashSet(nfa->TotalStates);
-    temp=NFA_get_transitions(nfa, 0, input[0]);
-    IntHashSet temp1=new_IntHashSet(nfa->TotalStates);
-    IntHashSetIterator iterator;
-    int length=(int)strlen(input);
-    for(int i=0;i<length;i++)
-    {
-        iterator=IntHashSet_iterator(temp);
-        while(IntHashSetIterator_hasNext(iterator))
-        {
-            int element=IntHashSetIterator_next(iterator);
-            IntHashSet_union(temp1, NFA_get_transitions(nfa, element, input[i]));
-        }
-        temp=temp1;
-        temp1=new_IntHashSet(nfa->TotalStates);
-    }
-    free(iterator);
-    IntHashSet_free(temp1);
-    IntHashSetIterator iterator1=IntHashSet_iterator(temp);
-    while(IntHashSetIterator_hasNext(iterator1))
-    {
-        int element1=IntHashSetIterator_next(iterator1);
-        if(NFA_get_accepting(nfa, element1)==1)
-        {
-            free(iterator1);
-            IntHashSet_free(temp);
-            return 1;
-        }
-    }
-    free(iterator1);
-    IntHashSet_free(temp);
-    return 0;
-}
-
-
+#include "nfa.h"
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "Set.h"
+#include "LinkedList.h"
+
+struct NFA_edge {
+    int src;
+    int dst;
+    unsigned char lo;
+    unsigned char hi;
+};
+
+NFA new_NFA(int nstates){
+	return new_NFA_in(NULL, nstates);
+}
+NFA new_NFA_in(Arena arena, int nstates){
+	NFA this=(NFA)Arena_malloc(arena, sizeof(struct NFA));
+	this->arena=arena;
+	this->TotalStates=nstates;
+	this->Accepting=(bool *)Arena_calloc(arena, nstates>0?nstates:1,sizeof(bool));
+	this->NumEdges=0;
+	this->EdgeCapacity=16;
+	this->Edges=(struct NFA_edge *)Arena_malloc(arena, this->EdgeCapacity*sizeof(struct NFA_edge));
+	this->NumEpsilons=0;
+	this->EpsilonCapacity=0;
+	this->Epsilons=NULL;
+	this->Compiled=false;
+	this->NumClasses=0;
+	this->Offsets=NULL;
+	this->Successors=NULL;
+	this->Start=NULL;
+	this->NumStart=0;
+	this->Masks=NULL;
+	this->StartMask=0;
+	this->Transitions=NULL;
+	this->Scratch=NULL;
+	return this;
+}
+/*
+ * Drop the compiled form, which no longer matches the transitions.
+ */
+static void NFA_changed(NFA nfa)
+{
+    if(!nfa->Compiled)
+        return;
+    Arena_release(nfa->arena, nfa->Offsets);
+    Arena_release(nfa->arena, nfa->Successors);
+    Arena_release(nfa->arena, nfa->Start);
+    Arena_release(nfa->arena, nfa->Masks);
+    nfa->Offsets=NULL;
+    nfa->Successors=NULL;
+    nfa->Start=NULL;
+    nfa->NumStart=0;
+    nfa->Masks=NULL;
+    nfa->StartMask=0;
+    nfa->Compiled=false;
+}
+void NFA_free(NFA nfa)
+{
+    if(nfa==NULL)
+        return;
+    NFA_changed(nfa);
+    if(nfa->Transitions!=NULL)
+        Set_free(nfa->Transitions);
+    NFA_scratch_free(nfa->Scratch);
+    Arena_release(nfa->arena, nfa->Edges);
+    Arena_release(nfa->arena, nfa->Epsilons);
+    Arena_release(nfa->arena, nfa->Accepting);
+    Arena_release(nfa->arena, nfa);
+    return;
+}
+/*
+ * Record a transition from src to dst on each byte from lo to hi.
+ */
+static void NFA_add_edge(NFA nfa, int src, unsigned char lo, unsigned char hi, int dst)
+{
+    NFA_changed(nfa);
+    if(nfa->NumEdges==nfa->EdgeCapacity)
+    {
+        nfa->Edges=(struct NFA_edge *)Arena_realloc(nfa->arena, nfa->Edges, nfa->EdgeCapacity*sizeof(struct NFA_edge), 2*nfa->EdgeCapacity*sizeof(struct NFA_edge));
+        nfa->EdgeCapacity*=2;
+    }
+    struct NFA_edge *edge=&nfa->Edges[nfa->NumEdges++];
+    edge->src=src;
+    edge->dst=dst;
+    edge->lo=lo;
+    edge->hi=hi;
+}
+int NFA_get_size(NFA nfa)
+{
+    return nfa->TotalStates;
+}
+Set NFA_get_transitions(NFA nfa, int state, char sym)
+{
+    if(state>=nfa->TotalStates||state<0)
+    {
+        printf("%s\n","input error");
+        return NULL;
+    }
+    NFA_compile(nfa);
+    if(nfa->Transitions!=NULL)
+        Set_free(nfa->Transitions);
+    nfa->Transitions=new_Set(nfa->TotalStates);
+    size_t row=(size_t)state*nfa->NumClasses+nfa->ByteClass[(unsigned char)sym];
+    for(int i=nfa->Offsets[row];i<nfa->Offsets[row+1];i++)
+    {
+        Set_insert(nfa->Transitions, nfa->Successors[i]);
+    }
+    return nfa->Transitions;
+}
+void NFA_add_transition(NFA nfa, int src, char sym, int dst)
+{
+    if(src>=nfa->TotalStates||src<0||dst>=nfa->TotalStates||dst<0)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    NFA_add_edge(nfa, src, (unsigned char)sym, (unsigned char)sym, dst);
+}
+void NFA_add_transition_str(NFA nfa, int src, char *str, int dst)
+{
+    if(src>=nfa->TotalStates||src<0||dst>=nfa->TotalStates||dst<0)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    int length=(int) strlen(str);
+    for(int i=0;i<length;i++)
+    {
+        NFA_add_edge(nfa, src, (unsigned char)str[i], (unsigned char)str[i], dst);
+    }
+}
+void NFA_add_transition_all(NFA nfa, int src, int dst)
+{
+    if(src>=nfa->TotalStates||src<0||dst>=nfa->TotalStates||dst<0)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    NFA_add_edge(nfa, src, 0, 127, dst);
+}
+void NFA_add_transition_range(NFA nfa, int src, unsigned char lo, unsigned char hi, int dst)
+{
+    if(src>=nfa->TotalStates||src<0||dst>=nfa->TotalStates||dst<0||lo>hi)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    NFA_add_edge(nfa, src, lo, hi, dst);
+}
+void NFA_add_epsilon(NFA nfa, int src, int dst)
+{
+    if(src>=nfa->TotalStates||src<0||dst>=nfa->TotalStates||dst<0)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    NFA_changed(nfa);
+    if(nfa->NumEpsilons==nfa->EpsilonCapacity)
+    {
+        int capacity=nfa->EpsilonCapacity>0?2*nfa->EpsilonCapacity:16;
+        nfa->Epsilons=(int *)Arena_realloc(nfa->arena, nfa->Epsilons, 2*sizeof(int)*nfa->EpsilonCapacity, 2*sizeof(int)*capacity);
+        nfa->EpsilonCapacity=capacity;
+    }
+    nfa->Epsilons[2*nfa->NumEpsilons]=src;
+    nfa->Epsilons[2*nfa->NumEpsilons+1]=dst;
+    nfa->NumEpsilons++;
+}
+void NFA_add_transition_Except(NFA nfa,int src,char string,int dst)
+{
+    if(src>=nfa->TotalStates||src<0||dst>=nfa->TotalStates||dst<0)
+    {
+        printf("%s\n","input error");
+        return;
+    }
+    unsigned char except=(unsigned char)string;
+    if(except>127)
+    {
+        NFA_add_edge(nfa, src, 0, 127, dst);
+        return;
+    }
+    if(except>0)
+        NFA_add_edge(nfa, src, 0, except-1, dst);
+    if(except<127)
+        NFA_add_edge(nfa, src, except+1, 127, dst);
+}
+NFA NFA_union(NFA *nfas, int count, int *pattern)
+{
+    int total=1;
+    for(int i=0;i<count;i++)
+    {
+        total+=nfas[i]->TotalStates;
+    }
+    NFA this=new_NFA(total);
+    if(pattern!=NULL)
+        pattern[0]=-1;
+    int base=1;
+    for(int i=0;i<count;i++)
+    {
+        NFA nfa=nfas[i];
+        if(nfa->TotalStates==0)
+            continue;
+        NFA_add_epsilon(this, 0, base);
+        for(int e=0;e<nfa->NumEdges;e++)
+        {
+            struct NFA_edge *edge=&nfa->Edges[e];
+            NFA_add_edge(this, base+edge->src, edge->lo, edge->hi, base+edge->dst);
+        }
+        for(int e=0;e<nfa->NumEpsilons;e++)
+        {
+            NFA_add_epsilon(this, base+nfa->Epsilons[2*e], base+nfa->Epsilons[2*e+1]);
+        }
+        for(int s=0;s<nfa->TotalStates;s++)
+        {
+            this->Accepting[base+s]=nfa->Accepting[s];
+            if(pattern!=NULL)
+                pattern[base+s]=i;
+        }
+        base+=nfa->TotalStates;
+    }
+    return this;
+}
+void NFA_set_accepting(NFA nfa, int state, bool value)
+{
+    if(state<0||state>=nfa->TotalStates)
+        return;
+    nfa->Accepting[state]=value;
+}
+bool NFA_get_accepting(NFA nfa, int state)
+{
+    if(state<0||state>=nfa->TotalStates)
+        return false;
+    return nfa->Accepting[state];
+}
+/*
+ * Order edges by source state, then destination, so that the transitions
+ * out of a state on a byte come out sorted and with duplicates adjacent.
+ */
+static int NFA_compare_edges(const void *a, const void *b)
+{
+    const struct NFA_edge *x=a;
+    const struct NFA_edge *y=b;
+    if(x->src!=y->src)
+        return x->src<y->src?-1:1;
+    if(x->dst!=y->dst)
+        return x->dst<y->dst?-1:1;
+    return (int)x->lo-(int)y->lo;
+}
+
+/*
+ * Append to pairs the edges out of any state on byte b, as (src,dst) pairs
+ * without duplicates, and return how many there were.
+ */
+static int NFA_edges_on(NFA nfa, int b, int *pairs)
+{
+    int count=0;
+    for(int e=0;e<nfa->NumEdges;e++)
+    {
+        struct NFA_edge *edge=&nfa->Edges[e];
+        if(edge->lo>b||edge->hi<b)
+            continue;
+        if(count>0&&pairs[2*count-2]==edge->src&&pairs[2*count-1]==edge->dst)
+            continue;
+        pairs[2*count]=edge->src;
+        pairs[2*count+1]=edge->dst;
+        count++;
+    }
+    return count;
+}
+
+/*
+ * Work out the ε-closure of every state, as the lists
+ * closure[closureOffsets[s]..closureOffsets[s+1]), each starting with s.
+ * A state with no ε-transitions out is its own closure; for the others,
+ * a search from the state collects the closure straight into the list,
+ * with seen[t]==s when t is already in it. A search that reaches a
+ * lower-numbered state takes in that state's (finished) closure whole
+ * instead of searching on from it. So the work and memory grow with the
+ * number of states plus the total size of the closures.
+ */
+static void NFA_epsilon_closures(NFA nfa, int *closureOffsets, int **closure)
+{
+    int n=nfa->TotalStates;
+    //ε-transitions grouped by source state
+    int *epsilonOffsets=(int *)calloc((size_t)n+1, sizeof(int));
+    int *epsilonTargets=(int *)malloc(sizeof(int)*((size_t)nfa->NumEpsilons+1));
+    for(int e=0;e<nfa->NumEpsilons;e++)
+    {
+        epsilonOffsets[nfa->Epsilons[2*e]+1]++;
+    }
+    for(int s=0;s<n;s++)
+    {
+        epsilonOffsets[s+1]+=epsilonOffsets[s];
+    }
+    int *fill=(int *)malloc(sizeof(int)*((size_t)n+1));
+    memcpy(fill, epsilonOffsets, sizeof(int)*n);
+    for(int e=0;e<nfa->NumEpsilons;e++)
+    {
+        epsilonTargets[fill[nfa->Epsilons[2*e]]++]=nfa->Epsilons[2*e+1];
+    }
+
+    int *stack=fill;
+    int *seen=(int *)malloc(sizeof(int)*((size_t)n+1));
+    for(int t=0;t<n;t++)
+    {
+        seen[t]=-1;
+    }
+    size_t capacity=(size_t)n+nfa->NumEpsilons+1;
+    int *list=(int *)malloc(sizeof(int)*capacity);
+    size_t size=0;
+    closureOffsets[0]=0;
+    for(int s=0;s<n;s++)
+    {
+        //a closure holds each state once, so n more entries always fit
+        if(size+n>capacity)
+        {
+            capacity=2*capacity>size+n?2*capacity:size+n;
+            list=(int *)realloc(list, sizeof(int)*capacity);
+        }
+        list[size++]=s;
+        seen[s]=s;
+        int top=0;
+        if(epsilonOffsets[s]<epsilonOffsets[s+1])
+            stack[top++]=s;
+        while(top>0)
+        {
+            int t=stack[--top];
+            for(int e=epsilonOffsets[t];e<epsilonOffsets[t+1];e++)
+            {
+                int u=epsilonTargets[e];
+                if(seen[u]==s)
+                    continue;
+                if(u<s)
+                {
+                    for(int j=closureOffsets[u];j<closureOffsets[u+1];j++)
+                    {
+                        int v=list[j];
+                        if(seen[v]!=s)
+                        {
+                            seen[v]=s;
+                            list[size++]=v;
+                        }
+                    }
+                }
+                else
+                {
+                    seen[u]=s;
+                    list[size++]=u;
+                    stack[top++]=u;
+                }
+            }
+        }
+        closureOffsets[s+1]=(int)size;
+    }
+    *closure=list;
+    free(seen);
+    free(fill);
+    free(epsilonTargets);
+    free(epsilonOffsets);
+}
+
+/*
+ * Replace each row of successors by the union of their ε-closures, and
+ * the start states by the closure of state 0. Each row is gathered twice,
+ * once to size it and once to fill it, with mark[t]==row when t is
+ * already in the row.
+ */
+static void NFA_fold_closures(NFA nfa)
+{
+    int n=nfa->TotalStates;
+    size_t rows=(size_t)n*nfa->NumClasses;
+    int *closureOffsets=(int *)malloc(sizeof(int)*((size_t)n+1));
+    int *closure;
+    NFA_epsilon_closures(nfa, closureOffsets, &closure);
+    long *mark=(long *)malloc(sizeof(long)*n);
+    int *offsets=(int *)Arena_calloc(nfa->arena, rows+1, sizeof(int));
+    for(int pass=0;pass<2;pass++)
+    {
+        int *successors=NULL;
+        if(pass==1)
+            successors=(int *)Arena_malloc(nfa->arena, sizeof(int)*((size_t)offsets[rows]+1));
+        for(int t=0;t<n;t++)
+        {
+            mark[t]=-1;
+        }
+        for(size_t row=0;row<rows;row++)
+        {
+            int count=0;
+            for(int i=nfa->Offsets[row];i<nfa->Offsets[row+1];i++)
+            {
+                int dst=nfa->Successors[i];
+                for(int j=closureOffsets[dst];j<closureOffsets[dst+1];j++)
+                {
+                    int t=closure[j];
+                    if(mark[t]==(long)row)
+                        continue;
+                    mark[t]=(long)row;
+                    if(pass==1)
+                        successors[offsets[row]+count]=t;
+                    count++;
+                }
+            }
+            if(pass==0)
+                offsets[row+1]=offsets[row]+count;
+        }
+        if(pass==1)
+        {
+            Arena_release(nfa->arena, nfa->Offsets);
+            Arena_release(nfa->arena, nfa->Successors);
+            nfa->Offsets=offsets;
+            nfa->Successors=successors;
+        }
+    }
+    nfa->NumStart=closureOffsets[1];
+    nfa->Start=(int *)Arena_malloc(nfa->arena, sizeof(int)*nfa->NumStart);
+    memcpy(nfa->Start, closure, sizeof(int)*nfa->NumStart);
+    free(mark);
+    free(closure);
+    free(closureOffsets);
+}
+
+/*
+ * Build the successor masks: bit t of Masks[c*n+s] is set when the NFA
+ * can go from state s to state t on the bytes of class c.
+ */
+static void NFA_build_masks(NFA nfa)
+{
+    int n=nfa->TotalStates;
+    nfa->Masks=(unsigned long long *)Arena_calloc(nfa->arena, (size_t)nfa->NumClasses*n+1, sizeof(unsigned long long));
+    nfa->StartMask=0;
+    for(int i=0;i<nfa->NumStart;i++)
+    {
+        nfa->StartMask|=1ULL<<nfa->Start[i];
+    }
+    for(int s=0;s<n;s++)
+    {
+        for(int c=0;c<nfa->NumClasses;c++)
+        {
+            size_t row=(size_t)s*nfa->NumClasses+c;
+            for(int i=nfa->Offsets[row];i<nfa->Offsets[row+1];i++)
+            {
+                nfa->Masks[(size_t)c*n+s]|=1ULL<<nfa->Successors[i];
+            }
+        }
+    }
+}
+
+void NFA_compile(NFA nfa)
+{
+    if(nfa->Compiled)
+        return;
+    int n=nfa->TotalStates;
+    qsort(nfa->Edges, nfa->NumEdges, sizeof(struct NFA_edge), NFA_compare_edges);
+
+    //bytes between consecutive range boundaries all behave the same
+    bool cut[257]={false};
+    int depth[257]={0};
+    cut[0]=true;
+    for(int e=0;e<nfa->NumEdges;e++)
+    {
+        cut[nfa->Edges[e].lo]=true;
+        cut[nfa->Edges[e].hi+1]=true;
+        depth[nfa->Edges[e].lo]++;
+        depth[nfa->Edges[e].hi+1]--;
+    }
+    //is there a byte that no edge is labeled with?
+    bool uncovered=false;
+    for(int b=0,inside=0;b<256&&!uncovered;b++)
+    {
+        inside+=depth[b];
+        uncovered=inside==0;
+    }
+
+    //give each such segment the class of an earlier one with the same
+    //(src,dst) pairs, or a new class; if some byte has no pairs at all,
+    //class 0 is kept for those bytes, so there are never more than 256
+    int *pairs=(int *)malloc(sizeof(int)*(2*(size_t)nfa->NumEdges+1));
+    int *classPairs=(int *)malloc(sizeof(int));
+    int classStart[256];
+    int classCount[256];
+    int used=0;
+    int k=0;
+    if(uncovered)
+    {
+        classStart[0]=0;
+        classCount[0]=0;
+        k=1;
+    }
+    for(int b=0;b<256;)
+    {
+        int count=NFA_edges_on(nfa, b, pairs);
+        int c;
+        for(c=0;c<k;c++)
+        {
+            if(classCount[c]==count&&memcmp(classPairs+classStart[c], pairs, sizeof(int)*2*count)==0)
+                break;
+        }
+        if(c==k)
+        {
+            classPairs=(int *)realloc(classPairs, sizeof(int)*((size_t)used+2*count+1));
+            memcpy(classPairs+used, pairs, sizeof(int)*2*count);
+            classStart[k]=used;
+            classCount[k]=count;
+            used+=2*count;
+            k++;
+        }
+        do
+        {
+            nfa->ByteClass[b++]=(unsigned char)c;
+        } while(b<256&&!cut[b]);
+    }
+    free(pairs);
+    nfa->NumClasses=k;
+
+    //one row of successors per state and class, packed in that order
+    nfa->Offsets=(int *)Arena_calloc(nfa->arena, (size_t)n*k+1, sizeof(int));
+    for(int c=0;c<k;c++)
+    {
+        for(int i=0;i<classCount[c];i++)
+        {
+            nfa->Offsets[(size_t)classPairs[classStart[c]+2*i]*k+c+1]++;
+        }
+    }
+    for(size_t row=0;row<(size_t)n*k;row++)
+    {
+        nfa->Offsets[row+1]+=nfa->Offsets[row];
+    }
+    nfa->Successors=(int *)Arena_malloc(nfa->arena, sizeof(int)*((size_t)nfa->Offsets[(size_t)n*k]+1));
+    for(int c=0;c<k;c++)
+    {
+        //pairs are sorted by source, so each row is filled in one run
+        for(int i=0;i<classCount[c];i++)
+        {
+            int src=classPairs[classStart[c]+2*i];
+            int first=i;
+            while(i+1<classCount[c]&&classPairs[classStart[c]+2*(i+1)]==src)
+                i++;
+            int offset=nfa->Offsets[(size_t)src*k+c];
+            for(int j=first;j<=i;j++)
+            {
+                nfa->Successors[offset++]=classPairs[classStart[c]+2*j+1];
+            }
+        }
+    }
+    free(classPairs);
+    if(nfa->NumEpsilons>0)
+    {
+        NFA_fold_closures(nfa);
+    }
+    else if(n>0)
+    {
+        nfa->NumStart=1;
+        nfa->Start=(int *)Arena_malloc(nfa->arena, sizeof(int));
+        nfa->Start[0]=0;
+    }
+    if(n<=64)
+        NFA_build_masks(nfa);
+    nfa->Compiled=true;
+}
+
+/*
+ * Index of the lowest set bit of the given (nonzero) mask.
+ */
+static int NFA_lowest_bit(unsigned long long mask)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#else
+    int i=0;
+    while(!(mask&1))
+    {
+        mask>>=1;
+        i++;
+    }
+    return i;
+#endif
+}
+
+/*
+ * Run an NFA of at most 64 states with the current states held as the
+ * bits of one word: each byte ORs together the successor masks of the
+ * states that are set.
+ */
+static bool NFA_execute_bits(NFA nfa, const unsigned char *input)
+{
+    int n=nfa->TotalStates;
+    unsigned long long current=nfa->StartMask;
+    for(size_t i=0;input[i]!='\0';i++)
+    {
+        const unsigned long long *successors=nfa->Masks+(size_t)nfa->ByteClass[input[i]]*n;
+        unsigned long long next=0;
+        for(unsigned long long rest=current;rest!=0;rest&=rest-1)
+        {
+            next|=successors[NFA_lowest_bit(rest)];
+        }
+        current=next;
+        if(current==0)
+            return false;
+    }
+    for(int s=0;s<n;s++)
+    {
+        if((current>>s&1)&&nfa->Accepting[s])
+            return true;
+    }
+    return false;
+}
+struct NFA_scratch {
+    int size;
+    int *current;       // states the NFA is in
+    int *next;          // states it goes to on the next byte
+    unsigned *seen;     // seen[t]==stamp when t is already in next
+    unsigned stamp;
+};
+
+NFA_scratch new_NFA_scratch(NFA nfa)
+{
+    NFA_scratch scratch=(NFA_scratch)malloc(sizeof(struct NFA_scratch));
+    scratch->size=nfa->TotalStates>0?nfa->TotalStates:1;
+    scratch->current=(int *)malloc(sizeof(int)*scratch->size);
+    scratch->next=(int *)malloc(sizeof(int)*scratch->size);
+    scratch->seen=(unsigned *)calloc(scratch->size, sizeof(unsigned));
+    scratch->stamp=0;
+    return scratch;
+}
+
+void NFA_scratch_free(NFA_scratch scratch)
+{
+    if(scratch==NULL)
+        return;
+    free(scratch->current);
+    free(scratch->next);
+    free(scratch->seen);
+    free(scratch);
+}
+
+/*
+ * Run an NFA of any size with its current and next states kept as lists
+ * in the scratch arrays, which are swapped after each byte. Membership in
+ * the next list is marked with a stamp that changes every byte, so the
+ * lists never need clearing.
+ */
+static bool NFA_execute_lists(NFA nfa, NFA_scratch scratch, const unsigned char *input)
+{
+    int k=nfa->NumClasses;
+    int *current=scratch->current;
+    int *next=scratch->next;
+    int count=nfa->NumStart;
+    memcpy(current, nfa->Start, sizeof(int)*count);
+    for(size_t i=0;input[i]!='\0';i++)
+    {
+        if(++scratch->stamp==0)
+        {
+            memset(scratch->seen, 0, sizeof(unsigned)*scratch->size);
+            scratch->stamp=1;
+        }
+        unsigned stamp=scratch->stamp;
+        int c=nfa->ByteClass[input[i]];
+        int nextCount=0;
+        for(int j=0;j<count;j++)
+        {
+            size_t row=(size_t)current[j]*k+c;
+            for(int t=nfa->Offsets[row];t<nfa->Offsets[row+1];t++)
+            {
+                int state=nfa->Successors[t];
+                if(scratch->seen[state]!=stamp)
+                {
+                    scratch->seen[state]=stamp;
+                    next[nextCount++]=state;
+                }
+            }
+        }
+        int *temp=current;
+        current=next;
+        next=temp;
+        count=nextCount;
+        if(count==0)
+            return false;
+    }
+    for(int j=0;j<count;j++)
+    {
+        if(nfa->Accepting[current[j]])
+            return true;
+    }
+    return false;
+}
+bool NFA_execute_scratch(NFA nfa, NFA_scratch scratch, const char *input)
+{
+    NFA_compile(nfa);
+    if(nfa->TotalStates==0)
+        return false;
+    if(nfa->TotalStates<=64)
+        return NFA_execute_bits(nfa, (const unsigned char *)input);
+    if(scratch->size<nfa->TotalStates)
+    {
+        scratch->size=nfa->TotalStates;
+        scratch->current=(int *)realloc(scratch->current, sizeof(int)*scratch->size);
+        scratch->next=(int *)realloc(scratch->next, sizeof(int)*scratch->size);
+        free(scratch->seen);
+        scratch->seen=(unsigned *)calloc(scratch->size, sizeof(unsigned));
+        scratch->stamp=0;
+    }
+    return NFA_execute_lists(nfa, scratch, (const unsigned char *)input);
+}
+bool NFA_execute(NFA nfa, char *input)
+{
+    if(nfa->TotalStates>64&&nfa->Scratch==NULL)
+        nfa->Scratch=new_NFA_scratch(nfa);
+    return NFA_execute_scratch(nfa, nfa->Scratch, input);
+}
+int NFA_byte_classes(NFA nfa, unsigned char *classes)
+{
+    NFA_compile(nfa);
+    memcpy(classes, nfa->ByteClass, 256);
+    return nfa->NumClasses;
+}
+
+#ifdef MAIN
+
+#include "dfa.h"
+#include "lazydfa.h"
+#include "check.h"
+
+/*
+ * An NFA whose start state goes to a different state on every byte needs
+ * all 256 classes, with none of them left over for bytes with no
+ * transitions. Byte b leads to state b+1, which accepts when b is odd.
+ */
+static void check_fan_out(void)
+{
+    NFA nfa=new_NFA(257);
+    for(int b=0;b<256;b++)
+    {
+        NFA_add_transition(nfa, 0, (char)b, b+1);
+        NFA_set_accepting(nfa, b+1, b%2==1);
+    }
+    unsigned char classes[256];
+    check(NFA_byte_classes(nfa, classes)==256, "256-way fan-out has 256 classes");
+    DFA dfa=Convert(nfa);
+    LazyDFA lazy=new_LazyDFA(nfa, 1<<20);
+    bool nfaOk=true;
+    bool dfaOk=true;
+    bool lazyOk=true;
+    for(int b=0;b<256;b++)
+    {
+        char input[2]={(char)b, '\0'};
+        if(b!=0&&NFA_execute(nfa, input)!=(b%2==1))
+            nfaOk=false;
+        if(DFA_execute_n(dfa, input, 1)!=(b%2==1))
+            dfaOk=false;
+        if(LazyDFA_execute(lazy, input, 1)!=(b%2==1))
+            lazyOk=false;
+    }
+    check(nfaOk&&NFA_execute(nfa, "\xff"), "NFA_execute on each byte of the fan-out");
+    check(dfaOk, "Convert of the fan-out on each byte");
+    check(lazyOk, "LazyDFA of the fan-out on each byte");
+    check(!NFA_execute(nfa, "\x01\x01"), "fan-out rejects two bytes");
+    LazyDFA_free(lazy);
+    DFA_free(dfa);
+    NFA_free(nfa);
+}
+
+int main(int argc, char **argv)
+{
+    check_fan_out();
+    return failures>0;
+}
+
+#endif
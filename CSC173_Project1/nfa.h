@@ -10,6 +10,7 @@
 
 #include <stdbool.h>
 #include "Set.h"
+#include "Arena.h"
 
 /**
  * The data structure used to represent a nondeterministic finite automaton.
@@ -19,16 +20,42 @@
 typedef struct NFA *NFA;
 struct NFA
 {
+    Arena arena;     // where the NFA's memory comes from (NULL for malloc)
     int TotalStates;
-    int AcceptIndex;
-    int *Accept;
-    IntHashSet *TransitionTable[128];
+    bool *Accepting; // per-state accept flag
+    // Transitions as added: (src, lo, hi, dst) byte ranges
+    struct NFA_edge *Edges;
+    int NumEdges;
+    int EdgeCapacity;
+    int *Epsilons;    // ε-transitions as added: (src, dst) pairs
+    int NumEpsilons;
+    int EpsilonCapacity;
+    // Compiled form, built by NFA_compile and dropped when a transition is added
+    bool Compiled;
+    int NumClasses;
+    unsigned char ByteClass[256];
+    int *Offsets;     // TotalStates*NumClasses+1 entries: the successors of state s on
+                      // class c are Successors[Offsets[s*NumClasses+c]..Offsets[s*NumClasses+c+1])
+    int *Successors;  // closed under ε-transitions
+    int *Start;       // the states reachable from state 0 by ε-transitions, 0 included
+    int NumStart;
+    unsigned long long *Masks; // when TotalStates <= 64, NumClasses rows of TotalStates successor masks
+    unsigned long long StartMask; // Start as a mask, when TotalStates <= 64
+    Set Transitions;  // returned by NFA_get_transitions
+    struct NFA_scratch *Scratch; // used by NFA_execute
 };
 /**
  * Allocate and return a new NFA containing the given number of states.
  */
 extern NFA new_NFA(int nstates);
 
+/**
+ * Allocate and return a new NFA like new_NFA(), whose transitions and
+ * compiled form come from the given Arena. NFA_free() then releases
+ * nothing that the Arena owns.
+ */
+extern NFA new_NFA_in(Arena arena, int nstates);
+
 /**
  * Free the given NFA.
  */
@@ -41,7 +68,9 @@ extern int NFA_get_size(NFA nfa);
 
 /**
  * Return the set of next states specified by the given NFA's transition
- * function from the given state on input symbol sym.
+ * function from the given state on input symbol sym, including those
+ * reachable from them by ε-transitions. The set belongs to the NFA and is
+ * only good until the next call.
  */
 extern Set NFA_get_transitions(NFA nfa, int state, char sym);
 
@@ -61,6 +90,29 @@ extern void NFA_add_transition_str(NFA nfa, int src, char *str, int dst);
  */
 extern void NFA_add_transition_all(NFA nfa, int src, int dst);
 
+/**
+ * Add a transition for the given NFA for each input byte from lo to hi
+ * (inclusive). The range is kept as one edge, however many bytes it has.
+ */
+extern void NFA_add_transition_range(NFA nfa, int src, unsigned char lo, unsigned char hi, int dst);
+
+/**
+ * Add an ε-transition for the given NFA from state src to state dst, taken
+ * without reading input. The NFA starts in every state reachable from
+ * state 0 this way.
+ */
+extern void NFA_add_epsilon(NFA nfa, int src, int dst);
+
+/**
+ * Return a new NFA that accepts the strings that any of the count given
+ * NFAs accepts. Its state 0 is new, with ε-transitions to the start state
+ * of each of the NFAs, whose states follow in the order given. If pattern
+ * isn't NULL, pattern[s] is set to the index of the NFA that state s came
+ * from, or -1 for state 0, so it needs room for one more entry than the
+ * NFAs have states in all.
+ */
+extern NFA NFA_union(NFA *nfas, int count, int *pattern);
+
 /**
  * Set whether the given NFA's state is accepting or not.
  */
@@ -78,12 +130,59 @@ extern void NFA_add_transition_Except(NFA nfa,int src,char string,int dst);
  */
 extern bool NFA_get_accepting(NFA nfa, int state);
 
+/**
+ * Build the given NFA's compiled form: its input bytes grouped into classes
+ * that every state treats the same way, and for each state and class the
+ * packed list of next states. The ε-closure of each state is worked out
+ * once here and folded into those lists and the start states, so running
+ * the compiled NFA never follows ε-transitions. Running or converting an
+ * NFA compiles it if needed, and adding a transition drops the compiled
+ * form. An NFA shared between threads must be compiled first.
+ */
+extern void NFA_compile(NFA nfa);
+
 /**
  * Run the given NFA on the given input string, and return true if it accepts
- * the input, otherwise false.
+ * the input, otherwise false. NFAs with at most 64 states are run with one
+ * bit per state, using successor masks built when the NFA is compiled.
+ * Larger ones use working space kept in the NFA, so only one thread at a
+ * time may run a given NFA this way (see NFA_execute_scratch).
  */
 extern bool NFA_execute(NFA nfa, char *input);
 
+// Partial declaration
+typedef struct NFA_scratch *NFA_scratch;
+
+/**
+ * Allocate and return the working space for running the given NFA (or any
+ * NFA with no more states) with NFA_execute_scratch. Each thread running
+ * an NFA needs its own.
+ */
+extern NFA_scratch new_NFA_scratch(NFA nfa);
+
+/**
+ * Free the given NFA_scratch.
+ */
+extern void NFA_scratch_free(NFA_scratch scratch);
+
+/**
+ * Run the given NFA on the given input string using the given working
+ * space, and return true if it accepts the input, otherwise false. Once
+ * the NFA is compiled this allocates no memory, so threads can share the
+ * NFA as long as each has its own NFA_scratch.
+ */
+extern bool NFA_execute_scratch(NFA nfa, NFA_scratch scratch, const char *input);
+
+/**
+ * Group the input bytes into classes of bytes that every state of the
+ * given NFA treats the same way, and set classes[b] to the class of byte b
+ * (classes must have room for 256 entries). If any byte has no
+ * transitions at all (every byte above 127 does unless transitions were
+ * added on it), class 0 holds those bytes. Returns the number of classes,
+ * at most 256.
+ */
+extern int NFA_byte_classes(NFA nfa, unsigned char *classes);
+
 /**
  * Print the given NFA to System.out.
  */
@@ -0,0 +1,48 @@
+/*
+ * File: nfa_regex.h
+ *
+ * Compile regular expressions straight into NFAs, by the Glushkov
+ * (position automaton) construction: one state per character or class in
+ * the pattern plus a start state, with byte ranges as transition labels
+ * and no ε-transitions.
+ *
+ * Syntax, loosest-binding first:
+ *   r|s        either r or s
+ *   rs         r followed by s
+ *   r* r+ r?   zero or more, one or more, zero or one r
+ *   (r)        grouping; () matches the empty string
+ *   c          the character c, unless it is one of \ | ( ) [ * + ? .
+ *   .          any character (0 to 127, like NFA_add_transition_all)
+ *   [abc] [a-z] [^abc]
+ *              any character listed or in a range, or (with ^) any
+ *              character 0 to 127 not listed; a ] right after [ or [^ is
+ *              listed rather than closing the class
+ *   \n \t \r   newline, tab, carriage return
+ *   \d \w \s   digit, word character (letter, digit or _), white space;
+ *              these may also be used inside [...]
+ *   \c         the character c, for any other c
+ *
+ * The NFA accepts the strings that the whole pattern matches, so use
+ * ".*code.*" for the strings that contain "code".
+ */
+
+#ifndef _nfa_regex_h
+#define _nfa_regex_h
+
+#include "nfa.h"
+#include "Arena.h"
+
+/**
+ * Compile the given pattern and return a new NFA that accepts exactly the
+ * strings it matches. If the pattern has a syntax error, return NULL, and
+ * if error isn't NULL, set *error to a message saying what was wrong.
+ */
+extern NFA Regex_compile(const char *pattern, const char **error);
+
+/**
+ * Compile the given pattern like Regex_compile(), with the NFA allocated in
+ * the given Arena (see new_NFA_in).
+ */
+extern NFA Regex_compile_in(Arena arena, const char *pattern, const char **error);
+
+#endif
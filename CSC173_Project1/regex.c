@@ -0,0 +1,507 @@
+/*
+ * File: regex.c
+ *
+ * Glushkov construction: each character or class in the pattern is a
+ * position, and the NFA has a state for each position (numbered from 1)
+ * plus the start state 0. Parsing works out, for each subexpression,
+ * whether it matches the empty string and which positions can come first
+ * and last in what it matches; putting subexpressions together records
+ * which positions can follow which. The NFA then goes from 0 to each
+ * first position of the whole pattern and from each position to each one
+ * that can follow it, on the bytes of the position it goes to, and accepts
+ * in the last positions (and in 0 if the pattern matches the empty string).
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "nfa_regex.h"
+
+/*
+ * What the parser knows about a subexpression.
+ */
+struct Regex_part {
+    bool nullable;    // matches the empty string
+    int *first;       // positions that can match its first character
+    int nfirst;
+    int *last;        // positions that can match its last character
+    int nlast;
+};
+
+struct Regex_parser {
+    const char *p;    // next character of the pattern
+    const char *error;
+    Arena arena;      // for everything below, freed once the NFA is built
+    int NumPositions;
+    int PositionCapacity;
+    int *RangeOffsets; // the byte ranges of position i are the (lo,hi) pairs
+                       // Ranges[2*RangeOffsets[i] .. 2*RangeOffsets[i+1])
+    unsigned char *Ranges;
+    int NumRanges;
+    int RangeCapacity;
+    int *Follow;      // (q,p) pairs: position p can follow position q
+    int NumFollow;
+    int FollowCapacity;
+};
+
+static struct Regex_part Regex_parse_alternation(struct Regex_parser *parser);
+
+static void Regex_fail(struct Regex_parser *parser, const char *error)
+{
+    if(parser->error==NULL)
+        parser->error=error;
+}
+
+/*
+ * Add a position matching the bytes set in the given table, and return it.
+ */
+static int Regex_position(struct Regex_parser *parser, const bool *bytes)
+{
+    if(parser->NumPositions+1==parser->PositionCapacity)
+    {
+        parser->RangeOffsets=(int *)Arena_realloc(parser->arena, parser->RangeOffsets, sizeof(int)*parser->PositionCapacity, 2*sizeof(int)*parser->PositionCapacity);
+        parser->PositionCapacity*=2;
+    }
+    for(int b=0;b<256;)
+    {
+        if(!bytes[b])
+        {
+            b++;
+            continue;
+        }
+        int lo=b;
+        while(b<256&&bytes[b])
+            b++;
+        if(parser->NumRanges==parser->RangeCapacity)
+        {
+            parser->Ranges=(unsigned char *)Arena_realloc(parser->arena, parser->Ranges, 2*parser->RangeCapacity, 4*parser->RangeCapacity);
+            parser->RangeCapacity*=2;
+        }
+        parser->Ranges[2*parser->NumRanges]=(unsigned char)lo;
+        parser->Ranges[2*parser->NumRanges+1]=(unsigned char)(b-1);
+        parser->NumRanges++;
+    }
+    parser->RangeOffsets[++parser->NumPositions]=parser->NumRanges;
+    return parser->NumPositions-1;
+}
+
+/*
+ * Record that each of the positions to can follow each of the positions from.
+ */
+static void Regex_follow(struct Regex_parser *parser, const int *from, int nfrom, const int *to, int nto)
+{
+    for(int i=0;i<nfrom;i++)
+    {
+        for(int j=0;j<nto;j++)
+        {
+            if(parser->NumFollow==parser->FollowCapacity)
+            {
+                parser->Follow=(int *)Arena_realloc(parser->arena, parser->Follow, 2*sizeof(int)*parser->FollowCapacity, 4*sizeof(int)*parser->FollowCapacity);
+                parser->FollowCapacity*=2;
+            }
+            parser->Follow[2*parser->NumFollow]=from[i];
+            parser->Follow[2*parser->NumFollow+1]=to[j];
+            parser->NumFollow++;
+        }
+    }
+}
+
+/*
+ * Return a new list of the given positions followed by the other given ones.
+ * Subexpressions never share positions, so there is nothing to merge.
+ */
+static int *Regex_join(struct Regex_parser *parser, const int *a, int na, const int *b, int nb)
+{
+    int *joined=(int *)Arena_malloc(parser->arena, sizeof(int)*((size_t)na+nb+1));
+    if(na>0)
+        memcpy(joined, a, sizeof(int)*na);
+    if(nb>0)
+        memcpy(joined+na, b, sizeof(int)*nb);
+    return joined;
+}
+
+static void Regex_set_range(bool *bytes, int lo, int hi)
+{
+    for(int b=lo;b<=hi;b++)
+    {
+        bytes[b]=true;
+    }
+}
+
+/*
+ * Read the escape after a backslash. A class escape (\d, \w or \s) sets
+ * its bytes in the given table and returns -1; any other escape returns
+ * the byte it stands for.
+ */
+static int Regex_escape(struct Regex_parser *parser, bool *bytes)
+{
+    unsigned char c=(unsigned char)*parser->p;
+    if(c=='\0')
+    {
+        Regex_fail(parser, "trailing backslash");
+        return -1;
+    }
+    parser->p++;
+    switch(c)
+    {
+    case 'n':
+        return '\n';
+    case 't':
+        return '\t';
+    case 'r':
+        return '\r';
+    case 'd':
+        Regex_set_range(bytes, '0', '9');
+        return -1;
+    case 'w':
+        Regex_set_range(bytes, '0', '9');
+        Regex_set_range(bytes, 'A', 'Z');
+        Regex_set_range(bytes, 'a', 'z');
+        bytes['_']=true;
+        return -1;
+    case 's':
+        Regex_set_range(bytes, '\t', '\r');//\t \n \v \f \r
+        bytes[' ']=true;
+        return -1;
+    default:
+        return c;
+    }
+}
+
+/*
+ * Read a class after its [, up to and including the ].
+ */
+static void Regex_parse_class(struct Regex_parser *parser, bool *bytes)
+{
+    bool negate=false;
+    if(*parser->p=='^')
+    {
+        negate=true;
+        parser->p++;
+    }
+    bool first=true;
+    while(parser->error==NULL)
+    {
+        unsigned char c=(unsigned char)*parser->p;
+        if(c=='\0')
+        {
+            Regex_fail(parser, "missing ]");
+            return;
+        }
+        if(c==']'&&!first)
+        {
+            parser->p++;
+            break;
+        }
+        first=false;
+        parser->p++;
+        int lo=c=='\\'?Regex_escape(parser, bytes):c;
+        if(lo<0)
+            continue;
+        if(parser->p[0]=='-'&&parser->p[1]!=']'&&parser->p[1]!='\0')
+        {
+            parser->p++;
+            unsigned char d=(unsigned char)*parser->p++;
+            int hi=d=='\\'?Regex_escape(parser, bytes):d;
+            if(hi<lo)
+            {
+                Regex_fail(parser, "bad range in []");
+                return;
+            }
+            Regex_set_range(bytes, lo, hi);
+        }
+        else
+        {
+            bytes[lo]=true;
+        }
+    }
+    if(negate)
+    {
+        for(int b=0;b<256;b++)
+        {
+            bytes[b]=b<=127&&!bytes[b];
+        }
+    }
+}
+
+/*
+ * atom: a character, escape, class or . (one position), or a group.
+ */
+static struct Regex_part Regex_parse_atom(struct Regex_parser *parser)
+{
+    struct Regex_part part={ true, NULL, 0, NULL, 0 };
+    unsigned char c=(unsigned char)*parser->p;
+    if(c=='(')
+    {
+        parser->p++;
+        part=Regex_parse_alternation(parser);
+        if(*parser->p!=')')
+            Regex_fail(parser, "missing )");
+        else
+            parser->p++;
+        return part;
+    }
+    if(c=='*'||c=='+'||c=='?')
+    {
+        Regex_fail(parser, "nothing to repeat");
+        return part;
+    }
+    bool bytes[256]={false};
+    parser->p++;
+    if(c=='.')
+    {
+        Regex_set_range(bytes, 0, 127);
+    }
+    else if(c=='[')
+    {
+        Regex_parse_class(parser, bytes);
+    }
+    else if(c=='\\')
+    {
+        int escaped=Regex_escape(parser, bytes);
+        if(escaped>=0)
+            bytes[escaped]=true;
+    }
+    else
+    {
+        bytes[c]=true;
+    }
+    int *position=(int *)Arena_malloc(parser->arena, sizeof(int));
+    *position=Regex_position(parser, bytes);
+    part.nullable=false;
+    part.first=part.last=position;
+    part.nfirst=part.nlast=1;
+    return part;
+}
+
+/*
+ * repeat: an atom followed by any number of *, + and ?.
+ */
+static struct Regex_part Regex_parse_repeat(struct Regex_parser *parser)
+{
+    struct Regex_part part=Regex_parse_atom(parser);
+    while(parser->error==NULL)
+    {
+        char c=*parser->p;
+        if(c!='*'&&c!='+'&&c!='?')
+            break;
+        parser->p++;
+        if(c!='?')
+            Regex_follow(parser, part.last, part.nlast, part.first, part.nfirst);
+        if(c!='+')
+            part.nullable=true;
+    }
+    return part;
+}
+
+/*
+ * concatenation: any number (even none) of repeats.
+ */
+static struct Regex_part Regex_parse_concatenation(struct Regex_parser *parser)
+{
+    struct Regex_part part={ true, NULL, 0, NULL, 0 };
+    while(parser->error==NULL&&*parser->p!='\0'&&*parser->p!='|'&&*parser->p!=')')
+    {
+        struct Regex_part next=Regex_parse_repeat(parser);
+        Regex_follow(parser, part.last, part.nlast, next.first, next.nfirst);
+        if(part.nullable)
+        {
+            part.first=Regex_join(parser, part.first, part.nfirst, next.first, next.nfirst);
+            part.nfirst+=next.nfirst;
+        }
+        if(next.nullable)
+        {
+            part.last=Regex_join(parser, part.last, part.nlast, next.last, next.nlast);
+            part.nlast+=next.nlast;
+        }
+        else
+        {
+            part.last=next.last;
+            part.nlast=next.nlast;
+        }
+        part.nullable=part.nullable&&next.nullable;
+    }
+    return part;
+}
+
+/*
+ * alternation: concatenations separated by |.
+ */
+static struct Regex_part Regex_parse_alternation(struct Regex_parser *parser)
+{
+    struct Regex_part part=Regex_parse_concatenation(parser);
+    while(parser->error==NULL&&*parser->p=='|')
+    {
+        parser->p++;
+        struct Regex_part next=Regex_parse_concatenation(parser);
+        part.nullable=part.nullable||next.nullable;
+        part.first=Regex_join(parser, part.first, part.nfirst, next.first, next.nfirst);
+        part.nfirst+=next.nfirst;
+        part.last=Regex_join(parser, part.last, part.nlast, next.last, next.nlast);
+        part.nlast+=next.nlast;
+    }
+    return part;
+}
+
+static int Regex_compare_pairs(const void *a, const void *b)
+{
+    const int *x=a;
+    const int *y=b;
+    if(x[0]!=y[0])
+        return x[0]<y[0]?-1:1;
+    return x[1]<y[1]?-1:x[1]>y[1];
+}
+
+/*
+ * Add the transitions from state src into position p's state, on p's bytes.
+ */
+static void Regex_add_edges(struct Regex_parser *parser, NFA nfa, int src, int p)
+{
+    for(int r=parser->RangeOffsets[p];r<parser->RangeOffsets[p+1];r++)
+    {
+        NFA_add_transition_range(nfa, src, parser->Ranges[2*r], parser->Ranges[2*r+1], p+1);
+    }
+}
+
+NFA Regex_compile(const char *pattern, const char **error)
+{
+    return Regex_compile_in(NULL, pattern, error);
+}
+
+NFA Regex_compile_in(Arena arena, const char *pattern, const char **error)
+{
+    struct Regex_parser parser;
+    parser.p=pattern;
+    parser.error=NULL;
+    parser.arena=new_Arena(0);
+    parser.NumPositions=0;
+    parser.PositionCapacity=16;
+    parser.RangeOffsets=(int *)Arena_malloc(parser.arena, sizeof(int)*parser.PositionCapacity);
+    parser.RangeOffsets[0]=0;
+    parser.NumRanges=0;
+    parser.RangeCapacity=16;
+    parser.Ranges=(unsigned char *)Arena_malloc(parser.arena, 2*parser.RangeCapacity);
+    parser.NumFollow=0;
+    parser.FollowCapacity=16;
+    parser.Follow=(int *)Arena_malloc(parser.arena, 2*sizeof(int)*parser.FollowCapacity);
+
+    struct Regex_part part=Regex_parse_alternation(&parser);
+    if(parser.error==NULL&&*parser.p==')')
+        Regex_fail(&parser, "unmatched )");
+    if(parser.error!=NULL)
+    {
+        if(error!=NULL)
+            *error=parser.error;
+        Arena_free(parser.arena);
+        return NULL;
+    }
+
+    NFA nfa=new_NFA_in(arena, parser.NumPositions+1);
+    NFA_set_accepting(nfa, 0, part.nullable);
+    for(int i=0;i<part.nlast;i++)
+    {
+        NFA_set_accepting(nfa, part.last[i]+1, true);
+    }
+    for(int i=0;i<part.nfirst;i++)
+    {
+        Regex_add_edges(&parser, nfa, 0, part.first[i]);
+    }
+    //a star inside a star can record the same pair more than once
+    qsort(parser.Follow, parser.NumFollow, 2*sizeof(int), Regex_compare_pairs);
+    for(int i=0;i<parser.NumFollow;i++)
+    {
+        if(i>0&&parser.Follow[2*i]==parser.Follow[2*i-2]&&parser.Follow[2*i+1]==parser.Follow[2*i-1])
+            continue;
+        Regex_add_edges(&parser, nfa, parser.Follow[2*i]+1, parser.Follow[2*i+1]);
+    }
+    Arena_free(parser.arena);
+    return nfa;
+}
+
+#ifdef MAIN
+
+#include "dfa.h"
+#include "check.h"
+
+/*
+ * The given pattern must compile, and both its NFA and the DFA converted
+ * from it must accept each of the accept strings and none of the reject
+ * strings (both lists end with NULL).
+ */
+static void check_pattern(const char *pattern, const char **accept, const char **reject)
+{
+    char what[128];
+    const char *error=NULL;
+    NFA nfa=Regex_compile(pattern, &error);
+    snprintf(what, sizeof(what), "\"%s\" compiles", pattern);
+    check(nfa!=NULL&&error==NULL, what);
+    if(nfa==NULL)
+        return;
+    DFA dfa=Convert(nfa);
+    bool ok=true;
+    for(int i=0;accept[i]!=NULL;i++)
+        if(!NFA_execute(nfa, (char *)accept[i])||!DFA_execute_n(dfa, accept[i], strlen(accept[i])))
+            ok=false;
+    for(int i=0;reject[i]!=NULL;i++)
+        if(NFA_execute(nfa, (char *)reject[i])||DFA_execute_n(dfa, reject[i], strlen(reject[i])))
+            ok=false;
+    snprintf(what, sizeof(what), "\"%s\" accepts and rejects the right strings", pattern);
+    check(ok, what);
+    DFA_free(dfa);
+    NFA_free(nfa);
+}
+
+/*
+ * The given pattern must fail to compile with the given message.
+ */
+static void check_error(const char *pattern, const char *message)
+{
+    char what[128];
+    const char *error=NULL;
+    NFA nfa=Regex_compile(pattern, &error);
+    snprintf(what, sizeof(what), "\"%s\" fails with \"%s\"", pattern, message);
+    check(nfa==NULL&&error!=NULL&&strcmp(error, message)==0, what);
+    NFA_free(nfa);
+}
+
+#define STRINGS(...) (const char *[]){ __VA_ARGS__, NULL }
+
+int main(int argc, char **argv)
+{
+    check_pattern("", STRINGS(""), STRINGS("a"));
+    check_pattern("abc", STRINGS("abc"), STRINGS("", "ab", "abcd"));
+    check_pattern("a|bc", STRINGS("a", "bc"), STRINGS("", "b", "abc"));
+    check_pattern("ab*", STRINGS("a", "ab", "abbb"), STRINGS("", "b", "aba"));
+    check_pattern("ab+", STRINGS("ab", "abbb"), STRINGS("a", "b"));
+    check_pattern("ab?c", STRINGS("ac", "abc"), STRINGS("abbc", "a"));
+    check_pattern("(ab)*", STRINGS("", "ab", "abab"), STRINGS("a", "aba"));
+    check_pattern("(a|b)+c", STRINGS("ac", "babc"), STRINGS("c", "ab"));
+    check_pattern("(a|b)*abb", STRINGS("abb", "aababb"), STRINGS("ab", "abba"));
+    check_pattern("()", STRINGS(""), STRINGS("a"));
+    check_pattern("a()b", STRINGS("ab"), STRINGS("a", "a()b"));
+    check_pattern("a**", STRINGS("", "a", "aaa"), STRINGS("b"));
+    check_pattern("(a*)*b", STRINGS("b", "aab"), STRINGS("", "a"));
+    check_pattern("a.c", STRINGS("abc", "a.c", "a c"), STRINGS("ac", "abbc"));
+    check_pattern("[a-c]x", STRINGS("ax", "bx", "cx"), STRINGS("dx", "x", "-x"));
+    check_pattern("[^a-c]", STRINGS("d", "-", " "), STRINGS("a", "c", "", "\xc8"));
+    check_pattern("[]a]", STRINGS("]", "a"), STRINGS("b", "[]"));
+    check_pattern("[^]a]", STRINGS("b", "["), STRINGS("]", "a"));
+    check_pattern("[a-]", STRINGS("a", "-"), STRINGS("b"));
+    check_pattern("\\.\\*\\(\\[", STRINGS(".*(["), STRINGS("a", ".*"));
+    check_pattern("\\n\\t\\r", STRINGS("\n\t\r"), STRINGS("ntr"));
+    check_pattern("\\d+", STRINGS("0", "123"), STRINGS("", "a", "1a"));
+    check_pattern("\\w\\w", STRINGS("a_", "Z9"), STRINGS("a-", "a"));
+    check_pattern("\\s", STRINGS(" ", "\t", "\n"), STRINGS("a", "s"));
+    check_pattern("[\\d_]+", STRINGS("1_2", "_"), STRINGS("a", "d"));
+    check_pattern(".*code.*", STRINGS("code", "barcodes"), STRINGS("cod", "c ode"));
+    check_error("ab\\", "trailing backslash");
+    check_error("[ab", "missing ]");
+    check_error("[z-a]", "bad range in []");
+    check_error("(ab", "missing )");
+    check_error("*a", "nothing to repeat");
+    check_error("a|+b", "nothing to repeat");
+    check_error("ab)", "unmatched )");
+    return failures>0;
+}
+
+#endif